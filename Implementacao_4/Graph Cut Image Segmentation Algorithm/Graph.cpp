@@ -4,61 +4,1120 @@
 #include <queue>
 #include <vector>
 #include <climits>
-#include <unordered_map>
+#include <deque>
+#include <chrono>
+#include <thread>
+#include <atomic>
+#include <mutex>
+#include <functional>
+#include <stdexcept>
+#include <cstdint>
+#include <limits>
+#include <type_traits>
 
 using namespace std;
 
-class Graph
+// Algoritmo usado por Graph::fordFulkerson para calcular o fluxo máximo
+enum class MaxFlowEngine
+{
+    EdmondsKarp,         // BFS a partir da fonte a cada caminho aumentante
+    BoykovKolmogorov,    // árvores de busca reaproveitadas entre aumentos
+    PushRelabel,         // push-relabel FIFO com global relabel e heurística de gap
+    ParallelPushRelabel, // push-relabel sem travas com várias threads
+};
+
+// Operações atômicas sobre variáveis comuns (builtins do GCC/Clang), usadas pelo
+// push-relabel paralelo para compartilhar os mesmos vetores do motor serial
+template <typename T>
+inline T atomicLoad(const T &value)
+{
+    T result;
+    __atomic_load(&value, &result, __ATOMIC_RELAXED);
+    return result;
+}
+
+template <typename T>
+inline void atomicStore(T &value, T newValue)
+{
+    __atomic_store(&value, &newValue, __ATOMIC_RELAXED);
+}
+
+// Devolve o valor anterior; não há fetch_add de ponto flutuante, então float usa compare-and-swap
+template <typename T>
+inline T atomicAdd(T &value, T delta)
+{
+    if constexpr (is_integral<T>::value)
+    {
+        return __atomic_fetch_add(&value, delta, __ATOMIC_RELAXED);
+    }
+    else
+    {
+        T expected = atomicLoad(value);
+        T desired = expected + delta;
+        while (!__atomic_compare_exchange(&value, &expected, &desired, true, __ATOMIC_RELAXED, __ATOMIC_RELAXED))
+        {
+            desired = expected + delta;
+        }
+        return expected;
+    }
+}
+
+// Troca value por candidate se candidate for menor; devolve true se trocou
+inline bool atomicMin(int &value, int candidate)
+{
+    int expected = atomicLoad(value);
+    while (candidate < expected)
+    {
+        if (__atomic_compare_exchange_n(&value, &expected, candidate, true, __ATOMIC_RELAXED, __ATOMIC_RELAXED))
+        {
+            return true;
+        }
+    }
+    return false;
+}
+
+/**
+ * Tipo das capacidades do grafo e conversão dos pesos da energia.
+ *
+ * - int: os pesos são truncados (comportamento original); com lambda pequeno
+ *   muitos n-links caem nos mesmos poucos valores inteiros.
+ * - int64_t: ponto fixo com 16 bits de fração (peso * 65536, arredondado); a
+ *   soma das capacidades de uma imagem grande continua longe do limite.
+ * - float: os pesos são usados como estão; resíduos até EPSILON contam como
+ *   arco saturado, para que erros de arredondamento não criem caminhos.
+ */
+template <typename Capacity>
+struct CapacityTraits;
+
+template <>
+struct CapacityTraits<int>
+{
+    static int fromWeight(double weight) { return static_cast<int>(weight); }
+    static double toWeight(int capacity) { return capacity; }
+    static bool isPositive(int capacity) { return capacity > 0; }
+};
+
+template <>
+struct CapacityTraits<int64_t>
+{
+    static constexpr int64_t ONE = int64_t(1) << 16;
+    static int64_t fromWeight(double weight) { return llround(weight * ONE); }
+    static double toWeight(int64_t capacity) { return static_cast<double>(capacity) / ONE; }
+    static bool isPositive(int64_t capacity) { return capacity > 0; }
+};
+
+template <>
+struct CapacityTraits<float>
+{
+    static constexpr float EPSILON = 1e-4f;
+    static float fromWeight(double weight) { return static_cast<float>(weight); }
+    static double toWeight(float capacity) { return capacity; }
+    static bool isPositive(float capacity) { return capacity > EPSILON; }
+};
+
+// Contadores da última execução de Graph::fordFulkerson (preenchidos pelo push-relabel)
+struct MaxFlowStats
+{
+    long long pushes = 0;         // operações de push
+    long long relabels = 0;       // relabels locais
+    long long globalRelabels = 0; // BFS reversas a partir do sorvedouro
+    long long gapNodes = 0;       // nós levantados para n pela heurística de gap
+    double phase1Seconds = 0.0;   // fase 1: pré-fluxo máximo (chega ao valor do fluxo)
+    double phase2Seconds = 0.0;   // fase 2: devolve o excesso restante para a fonte
+    double globalRelabelSeconds = 0.0;
+};
+
+/**
+ * Grafo residual em formato CSR (compressed sparse row).
+ *
+ * Todas as arestas ficam em um único vetor contíguo de arcos, agrupados por
+ * vértice de origem: os arcos que saem de u ocupam o intervalo
+ * [firstArc[u], firstArc[u + 1]). Cada arco guarda o vértice de destino, a
+ * capacidade residual e o índice do arco inverso, de modo que empurrar fluxo
+ * é feito apenas com acessos indexados, sem nenhuma tabela hash.
+ *
+ * As arestas adicionadas por add_edge/add_tlink/add_nlink ficam pendentes até
+ * a primeira chamada de fordFulkerson, quando o CSR é montado de uma só vez.
+ * Para a grade de uma imagem, buildGrid preenche o CSR diretamente, sem
+ * arestas pendentes: o layout dos arcos de cada pixel é fixo.
+ *
+ * Memória do grafo residual (grade 4-conectada com t-links em todo pixel):
+ * - 4 arcos de t-link por pixel (fonte->p, p->fonte, p->sorvedouro, sorvedouro->p);
+ * - 4 arcos de n-link por pixel (2 vizinhos, direita e abaixo, cada um com ida e volta);
+ * - 8 arcos * 12 bytes (Arc) + 4 bytes (firstArc) = 100 bytes por pixel
+ *   (132 bytes com capacidades int64_t, cujo Arc ocupa 16 bytes).
+ * Durante a montagem as arestas pendentes ocupam mais 16 bytes por aresta
+ * (64 bytes por pixel), liberados assim que o CSR fica pronto; buildGrid não
+ * usa essa memória extra.
+ *
+ * O tipo das capacidades é o parâmetro Capacity (int, int64_t em ponto fixo ou
+ * float; ver CapacityTraits); todos os motores funcionam com qualquer um deles.
+ */
+template <typename Capacity>
+class BasicGraph
 {
 private:
+    using Traits = CapacityTraits<Capacity>;
+
+    struct Arc
+    {
+        int head;          // vértice de destino
+        int reverse;       // índice do arco inverso
+        Capacity residual; // capacidade residual
+    };
+
+    struct PendingEdge
+    {
+        int u, v;
+        Capacity capUV, capVU;
+    };
+
     int vertices;
     int source;
     int sink;
-    unordered_map<int, unordered_map<int, int>> capacity;
-    unordered_map<int, unordered_map<int, int>> flow;
+    vector<PendingEdge> pending;
+    vector<int> firstArc;
+    vector<Arc> arcs;
+    bool built = false;
+    MaxFlowEngine engine = MaxFlowEngine::BoykovKolmogorov;
+    int threadCount = max(1u, thread::hardware_concurrency());
+    MaxFlowStats stats;
+
+    // Estado do push-relabel
+    vector<Capacity> excess;
+    vector<int> label;
+    vector<int> currentArc;
+    vector<int> labelCount; // quantidade de nós em cada rótulo < n (heurística de gap)
+
+    // Estado das árvores de busca do Boykov–Kolmogorov, mantido entre execuções (corte dinâmico)
+    vector<char> bkTree;
+    vector<int> bkParent;
+    vector<int> bkTimestamp;
+    vector<int> bkDist;
+    vector<char> bkIsActive;
+    vector<int> bkNextArc; // onde retomar o crescimento de cada nó
+    deque<int> bkActive;
+    deque<int> bkOrphans;
+    int bkTime = 0;
+    bool bkReady = false; // as árvores correspondem ao grafo residual atual
+
+    // Corte dinâmico
+    Capacity flow = 0;           // fluxo acumulado no grafo residual
+    Capacity shift = 0;          // constante somada a todo corte pelas reparametrizações
+    vector<Capacity> tlinkShift; // parte de shift em cada pixel (alocado na primeira atualização)
+    bool solved = false;         // fordFulkerson já foi chamado
+
+    // Sementes (pinSeeds)
+    vector<char> pinned;     // lado fixado de cada pixel: FREE, TREE_S (objeto) ou TREE_T (fundo)
+    Capacity pinnedCut = 0;  // arcos que todo corte paga por causa das sementes
+
+    void add_arc_pair(int u, int v, Capacity capUV, Capacity capVU)
+    {
+        pending.push_back({u, v, capUV, capVU});
+    }
+
+    // Monta o CSR a partir das arestas pendentes (contagem de graus + soma de prefixos)
+    void build()
+    {
+        if (built)
+        {
+            return;
+        }
+
+        vector<int> offset(vertices + 1, 0);
+        for (const PendingEdge &e : pending)
+        {
+            offset[e.u + 1]++;
+            offset[e.v + 1]++;
+        }
+        for (int u = 0; u < vertices; ++u)
+        {
+            offset[u + 1] += offset[u];
+        }
+
+        vector<Arc> newArcs(offset[vertices]);
+        vector<int> cursor(offset.begin(), offset.end() - 1);
+
+        for (const PendingEdge &e : pending)
+        {
+            int a = cursor[e.u]++;
+            int b = cursor[e.v]++;
+            newArcs[a] = {e.v, b, e.capUV};
+            newArcs[b] = {e.u, a, e.capVU};
+        }
+
+        firstArc.swap(offset);
+        arcs.swap(newArcs);
+        vector<PendingEdge>().swap(pending);
+        built = true;
+    }
+
+    // Marcas das árvores de busca do Boykov–Kolmogorov
+    static constexpr int TERMINAL = -2; // raiz de uma árvore (fonte ou sorvedouro)
+    static constexpr int ORPHAN = -1;   // nó que perdeu o arco até o pai
+    static constexpr char FREE = 0, TREE_S = 1, TREE_T = 2;
+
+    // Vértice pai de v: na árvore S o arco vai do pai para v, na árvore T vai de v para o pai
+    int bkParentVertex(int v) const
+    {
+        const Arc &arc = arcs[bkParent[v]];
+        return bkTree[v] == TREE_S ? arcs[arc.reverse].head : arc.head;
+    }
+
+    // Capacidade residual do arco a visto a partir da árvore t (S usa p->q, T usa q->p)
+    Capacity bkTreeResidual(char t, int a) const
+    {
+        return t == TREE_S ? arcs[a].residual : arcs[arcs[a].reverse].residual;
+    }
+
+    // Empurra até excess[u] unidades pelo arco a; devolve a quantidade empurrada
+    Capacity prPush(int u, int a)
+    {
+        Arc &arc = arcs[a];
+        Capacity delta = min(excess[u], arc.residual);
+        arc.residual -= delta;
+        arcs[arc.reverse].residual += delta;
+        excess[u] -= delta;
+        excess[arc.head] += delta;
+        stats.pushes++;
+        return delta;
+    }
+
+    /**
+     * Global relabel: rótulos exatos pela distância até o sorvedouro no grafo
+     * residual (BFS reversa). Nós que não alcançam o sorvedouro recebem n e
+     * ficam para a fase 2.
+     */
+    void prGlobalRelabel()
+    {
+        auto start = chrono::steady_clock::now();
+
+        fill(label.begin(), label.end(), vertices);
+        fill(labelCount.begin(), labelCount.end(), 0);
+        label[sink] = 0;
+        labelCount[0] = 1;
+
+        queue<int> q;
+        q.push(sink);
+        while (!q.empty())
+        {
+            int u = q.front();
+            q.pop();
+            for (int a = firstArc[u]; a < firstArc[u + 1]; ++a)
+            {
+                int v = arcs[a].head;
+                if (label[v] == vertices && v != source && Traits::isPositive(arcs[arcs[a].reverse].residual))
+                {
+                    label[v] = label[u] + 1;
+                    labelCount[label[v]]++;
+                    q.push(v);
+                }
+            }
+        }
+
+        for (int u = 0; u < vertices; ++u)
+        {
+            currentArc[u] = firstArc[u];
+        }
+
+        stats.globalRelabels++;
+        stats.globalRelabelSeconds += chrono::duration<double>(chrono::steady_clock::now() - start).count();
+    }
+
+    // Executa body(t) em threadCount threads, t = 0..threadCount-1, e espera todas terminarem
+    static void prRunThreads(int threadCount, const function<void(int)> &body)
+    {
+        vector<thread> workers;
+        for (int t = 0; t < threadCount; ++t)
+        {
+            workers.emplace_back(body, t);
+        }
+        for (thread &worker : workers)
+        {
+            worker.join();
+        }
+    }
+
+    /**
+     * Global relabel paralelo: os mesmos rótulos exatos de prGlobalRelabel,
+     * calculados por threadCount threads sem BFS em níveis.
+     *
+     * Cada thread cuida de uma faixa contígua de vértices (a mesma divisão do
+     * push-relabel paralelo) e começa pelos vértices da sua faixa com arco
+     * residual até o sorvedouro. Ao examinar u, cada vizinho v que alcança u
+     * recebe min(label[v], label[u] + 1) por compare-and-swap; se o rótulo
+     * diminuiu, v volta para a fila do dono da faixa (a própria fila ou a caixa
+     * de entrada de outra thread). Como cada fila é FIFO, quase todo vértice é
+     * examinado uma única vez; as correções aparecem só perto das bordas das
+     * faixas. labelCount não é atualizado: o motor paralelo não usa o gap.
+     */
+    void prParallelGlobalRelabel(int threadCount)
+    {
+        auto start = chrono::steady_clock::now();
+
+        const int blockSize = (vertices + threadCount - 1) / threadCount;
+        vector<char> queued(vertices, false);
+        vector<vector<int>> inbox(threadCount);
+        vector<mutex> inboxLock(threadCount);
+        vector<vector<int>> initial(threadCount);
+        atomic<long long> pending(0); // vértices enfileirados e ainda não examinados
+
+        // Rótulos iniciais: 1 para quem tem arco residual até o sorvedouro, n para os demais
+        prRunThreads(threadCount, [&](int t)
+        {
+            long long found = 0;
+            for (int u = t * blockSize; u < min(vertices, (t + 1) * blockSize); ++u)
+            {
+                label[u] = vertices;
+                currentArc[u] = firstArc[u];
+                if (u == source || u == sink)
+                {
+                    continue;
+                }
+                for (int a = firstArc[u]; a < firstArc[u + 1]; ++a)
+                {
+                    if (arcs[a].head == sink && Traits::isPositive(arcs[a].residual))
+                    {
+                        label[u] = 1;
+                        queued[u] = true;
+                        initial[t].push_back(u);
+                        ++found;
+                        break;
+                    }
+                }
+            }
+            pending.fetch_add(found, memory_order_relaxed);
+        });
+        label[sink] = 0;
+
+        prRunThreads(threadCount, [&](int t)
+        {
+            deque<int> fifo(initial[t].begin(), initial[t].end());
+
+            while (true)
+            {
+                if (fifo.empty())
+                {
+                    {
+                        lock_guard<mutex> guard(inboxLock[t]);
+                        fifo.insert(fifo.end(), inbox[t].begin(), inbox[t].end());
+                        inbox[t].clear();
+                    }
+                    if (fifo.empty())
+                    {
+                        if (pending.load(memory_order_acquire) == 0)
+                        {
+                            break;
+                        }
+                        this_thread::yield();
+                        continue;
+                    }
+                }
+
+                int u = fifo.front();
+                fifo.pop_front();
+                __atomic_exchange_n(&queued[u], char(0), __ATOMIC_ACQ_REL); // troca, não store: sincroniza com quem marcou u, e a atualização dele é vista abaixo
+
+                int next = atomicLoad(label[u]) + 1;
+                for (int a = firstArc[u]; a < firstArc[u + 1]; ++a)
+                {
+                    int v = arcs[a].head;
+                    if (v == source || v == sink || !Traits::isPositive(arcs[arcs[a].reverse].residual))
+                    {
+                        continue;
+                    }
+                    if (atomicMin(label[v], next) && !__atomic_exchange_n(&queued[v], char(1), __ATOMIC_ACQ_REL))
+                    {
+                        pending.fetch_add(1, memory_order_relaxed);
+                        int owner = v / blockSize;
+                        if (owner == t)
+                        {
+                            fifo.push_back(v);
+                        }
+                        else
+                        {
+                            lock_guard<mutex> guard(inboxLock[owner]);
+                            inbox[owner].push_back(v);
+                        }
+                    }
+                }
+                pending.fetch_sub(1, memory_order_acq_rel);
+            }
+        });
+
+        stats.globalRelabels++;
+        stats.globalRelabelSeconds += chrono::duration<double>(chrono::steady_clock::now() - start).count();
+    }
+
+    // Heurística de gap: se nenhum nó tem rótulo g, quem está acima de g não alcança mais o sorvedouro
+    void prGap(int g)
+    {
+        for (int u = 0; u < vertices; ++u)
+        {
+            if (label[u] > g && label[u] < vertices)
+            {
+                labelCount[label[u]]--;
+                label[u] = vertices;
+                currentArc[u] = firstArc[u];
+                stats.gapNodes++;
+            }
+        }
+    }
+
+    // Satura os arcos da fonte e calcula os rótulos iniciais (com threadCount > 1, em paralelo)
+    void prInitialize(int threadCount = 1)
+    {
+        excess.assign(vertices, 0);
+        label.assign(vertices, 0);
+        currentArc.assign(firstArc.begin(), firstArc.end() - 1);
+        labelCount.assign(vertices + 1, 0);
+
+        // Satura todos os arcos que saem da fonte
+        excess[source] = numeric_limits<Capacity>::max();
+        for (int a = firstArc[source]; a < firstArc[source + 1]; ++a)
+        {
+            if (Traits::isPositive(arcs[a].residual))
+            {
+                prPush(source, a);
+            }
+        }
+        excess[source] = 0;
+
+        if (threadCount > 1)
+        {
+            prParallelGlobalRelabel(threadCount);
+        }
+        else
+        {
+            prGlobalRelabel();
+        }
+    }
+
+    /**
+     * Fase 1: pré-fluxo máximo. Descarrega em ordem FIFO os nós com excesso e
+     * rótulo menor que n; ao final excess[sink] é o valor do fluxo máximo.
+     */
+    void prMaximumPreflow()
+    {
+        prInitialize();
+
+        deque<int> fifo;
+        vector<char> inQueue(vertices, false);
+        for (int u = 0; u < vertices; ++u)
+        {
+            if (u != source && u != sink && Traits::isPositive(excess[u]) && label[u] < vertices)
+            {
+                fifo.push_back(u);
+                inQueue[u] = true;
+            }
+        }
+
+        // Trabalho de relabel acumulado; um global relabel é feito quando passa de ~n + m
+        long long work = 0;
+        const long long globalRelabelWork = 6LL * vertices + (long long)arcs.size();
+
+        while (!fifo.empty())
+        {
+            int u = fifo.front();
+            fifo.pop_front();
+            inQueue[u] = false;
+
+            // Descarrega u até zerar o excesso ou o rótulo chegar a n
+            while (Traits::isPositive(excess[u]) && label[u] < vertices)
+            {
+                int end = firstArc[u + 1];
+                int a = currentArc[u];
+                for (; a < end && Traits::isPositive(excess[u]); ++a)
+                {
+                    int v = arcs[a].head;
+                    if (Traits::isPositive(arcs[a].residual) && label[u] == label[v] + 1)
+                    {
+                        prPush(u, a);
+                        if (!inQueue[v] && v != sink && label[v] < vertices)
+                        {
+                            fifo.push_back(v);
+                            inQueue[v] = true;
+                        }
+                        if (!Traits::isPositive(excess[u]))
+                        {
+                            break;
+                        }
+                    }
+                }
+                currentArc[u] = min(a, end - 1);
+
+                if (!Traits::isPositive(excess[u]))
+                {
+                    break;
+                }
+
+                // Relabel: menor rótulo entre os vizinhos residuais + 1
+                int oldLabel = label[u];
+                int newLabel = vertices;
+                for (int b = firstArc[u]; b < end; ++b)
+                {
+                    if (Traits::isPositive(arcs[b].residual))
+                    {
+                        newLabel = min(newLabel, label[arcs[b].head] + 1);
+                    }
+                }
+                newLabel = min(newLabel, vertices);
+                stats.relabels++;
+                work += 12 + end - firstArc[u];
+
+                labelCount[oldLabel]--;
+                label[u] = newLabel;
+                currentArc[u] = firstArc[u];
+                if (newLabel < vertices)
+                {
+                    labelCount[newLabel]++;
+                }
+                if (labelCount[oldLabel] == 0)
+                {
+                    prGap(oldLabel);
+                }
+
+                if (work > globalRelabelWork)
+                {
+                    work = 0;
+                    prGlobalRelabel();
+                }
+            }
+        }
+    }
+
+    /**
+     * Fase 2: transforma o pré-fluxo em fluxo devolvendo à fonte o excesso
+     * dos nós que não alcançam o sorvedouro. Os rótulos passam a ser
+     * n + distância até a fonte, de modo que nenhum push chega ao sorvedouro.
+     */
+    void prReturnExcess()
+    {
+        const int unreachable = INT_MAX / 2;
+        fill(label.begin(), label.end(), unreachable);
+        label[source] = vertices;
+
+        queue<int> q;
+        q.push(source);
+        while (!q.empty())
+        {
+            int u = q.front();
+            q.pop();
+            for (int a = firstArc[u]; a < firstArc[u + 1]; ++a)
+            {
+                int v = arcs[a].head;
+                if (label[v] == unreachable && v != sink && Traits::isPositive(arcs[arcs[a].reverse].residual))
+                {
+                    label[v] = label[u] + 1;
+                    q.push(v);
+                }
+            }
+        }
+
+        deque<int> fifo;
+        vector<char> inQueue(vertices, false);
+        for (int u = 0; u < vertices; ++u)
+        {
+            currentArc[u] = firstArc[u];
+            if (u != source && u != sink && Traits::isPositive(excess[u]))
+            {
+                fifo.push_back(u);
+                inQueue[u] = true;
+            }
+        }
+
+        while (!fifo.empty())
+        {
+            int u = fifo.front();
+            fifo.pop_front();
+            inQueue[u] = false;
+
+            while (Traits::isPositive(excess[u]))
+            {
+                int end = firstArc[u + 1];
+                int a = currentArc[u];
+                for (; a < end; ++a)
+                {
+                    int v = arcs[a].head;
+                    if (Traits::isPositive(arcs[a].residual) && label[u] == label[v] + 1)
+                    {
+                        prPush(u, a);
+                        if (!inQueue[v] && v != source)
+                        {
+                            fifo.push_back(v);
+                            inQueue[v] = true;
+                        }
+                        if (!Traits::isPositive(excess[u]))
+                        {
+                            break;
+                        }
+                    }
+                }
+                currentArc[u] = min(a, end - 1);
+
+                if (!Traits::isPositive(excess[u]))
+                {
+                    break;
+                }
+
+                int newLabel = unreachable;
+                for (int b = firstArc[u]; b < end; ++b)
+                {
+                    if (Traits::isPositive(arcs[b].residual))
+                    {
+                        newLabel = min(newLabel, label[arcs[b].head] + 1);
+                    }
+                }
+                label[u] = newLabel;
+                currentArc[u] = firstArc[u];
+                stats.relabels++;
+            }
+        }
+    }
+
+    /**
+     * Fase 1 paralela: push-relabel assíncrono sem travas (Hong e He, "A Lock-Free
+     * Multi-Threaded Algorithm for the Maximum Flow Problem", 2008).
+     *
+     * Os vértices são divididos em faixas contíguas (linhas da imagem), uma por
+     * thread. Cada thread é a única que diminui o excesso e altera o rótulo dos
+     * seus vértices; excessos e capacidades residuais dos vizinhos só aumentam
+     * por adições atômicas, por isso não há travas. O push é feito para o vizinho
+     * residual de menor rótulo e o relabel usa esse mesmo mínimo, o que mantém o
+     * algoritmo correto mesmo lendo rótulos desatualizados de outras threads.
+     *
+     * Cada thread tem a sua fila de vértices ativos. Um push que ativa um vértice
+     * de outra faixa o entrega na caixa de entrada do dono, que o descarrega na
+     * mesma rodada. A rodada termina quando nenhum vértice está enfileirado ou
+     * quando o trabalho de relabel passa do mesmo limite do motor serial; só
+     * então as threads param para um global relabel (também paralelo, ver
+     * prParallelGlobalRelabel), e cada uma recolhe os ativos da sua faixa
+     * para a rodada seguinte.
+     */
+    void prParallelMaximumPreflow(int threadCount)
+    {
+        prInitialize(threadCount);
+
+        const long long globalRelabelWork = 6LL * vertices + (long long)arcs.size();
+        const int blockSize = (vertices + threadCount - 1) / threadCount;
+        vector<long long> threadPushes(threadCount), threadRelabels(threadCount);
+        vector<char> queued(vertices, false); // vértice está na fila ou na caixa de entrada do dono
+        vector<vector<int>> inbox(threadCount);
+        vector<mutex> inboxLock(threadCount);
+        vector<vector<int>> initial(threadCount);
+        auto runThreads = [&](const function<void(int)> &body)
+        {
+            prRunThreads(threadCount, body);
+        };
+
+        while (true)
+        {
+            // Ativos de cada faixa após o global relabel
+            runThreads([&](int t)
+            {
+                initial[t].clear();
+                for (int u = t * blockSize; u < min(vertices, (t + 1) * blockSize); ++u)
+                {
+                    queued[u] = u != source && u != sink && Traits::isPositive(excess[u]) && label[u] < vertices;
+                    if (queued[u])
+                    {
+                        initial[t].push_back(u);
+                    }
+                }
+            });
+
+            atomic<long long> pending(0); // vértices enfileirados e ainda não descarregados
+            for (int t = 0; t < threadCount; ++t)
+            {
+                pending += initial[t].size();
+                inbox[t].clear();
+            }
+            if (pending == 0)
+            {
+                break;
+            }
+
+            atomic<long long> work(0);
+            atomic<bool> stop(false);
+            runThreads([&](int t)
+            {
+                long long pushes = 0, relabels = 0;
+                deque<int> fifo(initial[t].begin(), initial[t].end());
+
+                auto enqueue = [&](int v)
+                {
+                    if (__atomic_exchange_n(&queued[v], char(1), __ATOMIC_ACQ_REL))
+                    {
+                        return;
+                    }
+                    pending.fetch_add(1, memory_order_relaxed);
+                    int owner = v / blockSize;
+                    if (owner == t)
+                    {
+                        fifo.push_back(v);
+                    }
+                    else
+                    {
+                        lock_guard<mutex> guard(inboxLock[owner]);
+                        inbox[owner].push_back(v);
+                    }
+                };
+
+                while (!stop.load(memory_order_relaxed))
+                {
+                    if (fifo.empty())
+                    {
+                        {
+                            lock_guard<mutex> guard(inboxLock[t]);
+                            fifo.insert(fifo.end(), inbox[t].begin(), inbox[t].end());
+                            inbox[t].clear();
+                        }
+                        if (fifo.empty())
+                        {
+                            if (pending.load(memory_order_acquire) == 0)
+                            {
+                                break;
+                            }
+                            this_thread::yield();
+                            continue;
+                        }
+                    }
+
+                    int u = fifo.front();
+                    fifo.pop_front();
+                    __atomic_exchange_n(&queued[u], char(0), __ATOMIC_ACQ_REL); // troca, não store: sincroniza com quem marcou u, e a atualização dele é vista abaixo
+
+                    while (Traits::isPositive(atomicLoad(excess[u])) && label[u] < vertices && !stop.load(memory_order_relaxed))
+                    {
+                        // Vizinho residual de menor rótulo
+                        int best = -1;
+                        int bestLabel = INT_MAX;
+                        for (int a = firstArc[u]; a < firstArc[u + 1]; ++a)
+                        {
+                            if (Traits::isPositive(atomicLoad(arcs[a].residual)))
+                            {
+                                int h = atomicLoad(label[arcs[a].head]);
+                                if (h < bestLabel)
+                                {
+                                    bestLabel = h;
+                                    best = a;
+                                }
+                            }
+                        }
+
+                        if (best >= 0 && label[u] > bestLabel)
+                        {
+                            Arc &arc = arcs[best];
+                            int v = arc.head;
+                            Capacity delta = min(atomicLoad(excess[u]), atomicLoad(arc.residual));
+                            atomicAdd(arc.residual, -delta);
+                            atomicAdd(arcs[arc.reverse].residual, delta);
+                            atomicAdd(excess[u], -delta);
+                            Capacity before = atomicAdd(excess[v], delta);
+                            ++pushes;
+
+                            if (!Traits::isPositive(before) && v != sink && v != source && atomicLoad(label[v]) < vertices)
+                            {
+                                enqueue(v);
+                            }
+                        }
+                        else
+                        {
+                            int newLabel = best >= 0 ? min(bestLabel + 1, vertices) : vertices;
+                            atomicStore(label[u], newLabel);
+                            ++relabels;
+                            long long cost = 12 + firstArc[u + 1] - firstArc[u];
+                            if (work.fetch_add(cost, memory_order_relaxed) + cost > globalRelabelWork)
+                            {
+                                stop.store(true, memory_order_relaxed);
+                            }
+                        }
+                    }
+                    pending.fetch_sub(1, memory_order_acq_rel);
+                }
+
+                threadPushes[t] += pushes;
+                threadRelabels[t] += relabels;
+            });
+
+            if (!stop)
+            {
+                break; // nenhum vértice ativo sobrou
+            }
+            prParallelGlobalRelabel(threadCount);
+        }
+
+        for (int t = 0; t < threadCount; ++t)
+        {
+            stats.pushes += threadPushes[t];
+            stats.relabels += threadRelabels[t];
+        }
+    }
+
+    // Primeiro arco de u para v, ou -1
+    int findArc(int u, int v) const
+    {
+        for (int a = firstArc[u]; a < firstArc[u + 1]; ++a)
+        {
+            if (arcs[a].head == v)
+            {
+                return a;
+            }
+        }
+        return -1;
+    }
+
+    /**
+     * Dá aos t-links do pixel os pesos sourceWeight/sinkWeight com os fluxos
+     * sourceFlow (fonte->pixel) e sinkFlow (pixel->sorvedouro).
+     *
+     * O fluxo fonte->pixel->sorvedouro comum aos dois é cancelado. Se o fluxo
+     * restante ainda passa do novo peso, os dois t-links recebem o mesmo
+     * acréscimo (reparametrização): todo corte paga exatamente um deles, então o
+     * corte mínimo não muda e o acréscimo vai para shift. Por fim o caminho
+     * direto fonte->pixel->sorvedouro é saturado, de modo que no máximo um dos
+     * t-links fica com resíduo e o pixel pertence à árvore desse terminal.
+     */
+    void setTlinkFlow(int pixel, Capacity sourceWeight, Capacity sinkWeight, Capacity sourceFlow, Capacity sinkFlow)
+    {
+        int toSource = findArc(pixel, source);
+        int toSink = findArc(pixel, sink);
+        if (toSource < 0 || toSink < 0)
+        {
+            throw invalid_argument("BasicGraph: o pixel não tem t-links");
+        }
+        if (tlinkShift.empty())
+        {
+            tlinkShift.assign(vertices, 0);
+        }
+
+        Capacity cancelled = min(sourceFlow, sinkFlow);
+        sourceFlow -= cancelled;
+        sinkFlow -= cancelled;
+        flow -= cancelled;
+
+        Capacity newShift = max(Capacity(0), max(sourceFlow - sourceWeight, sinkFlow - sinkWeight));
+        shift += newShift - tlinkShift[pixel];
+        tlinkShift[pixel] = newShift;
+
+        Capacity direct = min(sourceWeight + newShift - sourceFlow, sinkWeight + newShift - sinkFlow);
+        sourceFlow += direct;
+        sinkFlow += direct;
+        flow += direct;
+
+        // O arco pixel->fonte tem capacidade 0: seu resíduo é o fluxo fonte->pixel (o mesmo vale para sorvedouro->pixel)
+        arcs[toSource].residual = sourceFlow;
+        arcs[arcs[toSource].reverse].residual = sourceWeight + newShift - sourceFlow;
+        arcs[toSink].residual = sinkWeight + newShift - sinkFlow;
+        arcs[arcs[toSink].reverse].residual = sinkFlow;
+    }
+
+    // Pesos dos t-links do pixel sem a reparametrização e os fluxos atuais
+    void tlinkState(int pixel, Capacity &sourceWeight, Capacity &sinkWeight, Capacity &sourceFlow, Capacity &sinkFlow) const
+    {
+        int toSource = findArc(pixel, source);
+        int toSink = findArc(pixel, sink);
+        if (toSource < 0 || toSink < 0)
+        {
+            throw invalid_argument("BasicGraph: o pixel não tem t-links");
+        }
+        Capacity pixelShift = tlinkShift.empty() ? Capacity(0) : tlinkShift[pixel];
+        sourceFlow = arcs[toSource].residual;
+        sinkFlow = arcs[arcs[toSink].reverse].residual;
+        sourceWeight = arcs[arcs[toSource].reverse].residual + sourceFlow - pixelShift;
+        sinkWeight = arcs[toSink].residual + sinkFlow - pixelShift;
+    }
+
+    bool isPinned(int v) const
+    {
+        return v < static_cast<int>(pinned.size()) && pinned[v] != FREE;
+    }
 
 public:
-    Graph(int vertices, int source, int sink)
+    BasicGraph(int vertices, int source, int sink)
         : vertices(vertices), source(source), sink(sink) {}
 
-    void add_edge(int u, int v, int cap)
+    /**
+     * Esvazia o grafo para montar outro, como se fosse recém-construído, mas
+     * mantendo a memória já alocada pelos vetores (CSR e estado do
+     * Boykov–Kolmogorov). Quem resolve muitos grafos em sequência (as tiles de
+     * segmentTiled) evita assim alocar e liberar dezenas de MiB por grafo, o
+     * que fragmenta o heap e faz o processo ocupar bem mais do que um grafo.
+     * O motor e a quantidade de threads são mantidos.
+     */
+    void reset(int newVertices, int newSource, int newSink)
+    {
+        vertices = newVertices;
+        source = newSource;
+        sink = newSink;
+        pending.clear();
+        built = false;
+        stats = MaxFlowStats();
+        bkActive.clear();
+        bkOrphans.clear();
+        bkTime = 0;
+        bkReady = false;
+        flow = 0;
+        shift = 0;
+        tlinkShift.clear();
+        solved = false;
+        pinned.clear();
+        pinnedCut = 0;
+    }
+
+    void add_edge(int u, int v, Capacity cap)
     {
-        capacity[u][v] = cap;
-        capacity[v][u] = 0; // aresta inversa (grafo residual)
+        add_arc_pair(u, v, cap, 0); // aresta inversa (grafo residual)
     }
 
-    void add_tlink(int pixel, int sourceWeight, int sinkWeight)
+    void add_tlink(int pixel, Capacity sourceWeight, Capacity sinkWeight)
     {
         add_edge(source, pixel, sourceWeight);
         add_edge(pixel, sink, sinkWeight);
     }
 
-    void add_nlink(int pixel1, int pixel2, int weight)
+    void add_nlink(int pixel1, int pixel2, Capacity weight)
     {
-        add_edge(pixel1, pixel2, weight);
-        add_edge(pixel2, pixel1, weight); // Aresta bidirecional
+        add_arc_pair(pixel1, pixel2, weight, weight); // Aresta bidirecional: cada arco é o inverso do outro
+    }
+
+    /**
+     * Tabelas de pesos dos t-links, indexadas pela intensidade (0 a 255).
+     *
+     * O peso é -log da probabilidade da intensidade no histograma do objeto
+     * (fonte) ou do fundo (sorvedouro), convertido por CapacityTraits; com a tabela o
+     * logaritmo é calculado 256 vezes, e não uma vez por pixel.
+     */
+    static void tlinkTables(const vector<int> &objectHistogram,
+                            const vector<int> &backgroundHistogram,
+                            vector<Capacity> &sourceWeights,
+                            vector<Capacity> &sinkWeights)
+    {
+        int maxIntensity = objectHistogram.size();
+        sourceWeights.assign(256, 0);
+        sinkWeights.assign(256, 0);
+        for (int intensity = 0; intensity < 256; ++intensity)
+        {
+            double P_object = max(min(static_cast<double>(objectHistogram[intensity]) / maxIntensity, 1.0), 1e-6);
+            double P_background = max(min(static_cast<double>(backgroundHistogram[intensity]) / maxIntensity, 1.0), 1e-6);
+
+            sourceWeights[intensity] = Traits::fromWeight(-log(P_object));
+            sinkWeights[intensity] = Traits::fromWeight(-log(P_background));
+        }
+    }
+
+    /**
+     * Tabela de pesos dos n-links, indexada pela diferença ao quadrado entre as
+     * intensidades dos dois pixels (0 a 255², 65536 entradas).
+     *
+     * peso = lambda * exp(-d² / (2 sigma²)), convertido por CapacityTraits.
+     */
+    static vector<Capacity> nlinkTable(double sigma, double lambda)
+    {
+        vector<Capacity> weights(65536, 0);
+        for (int squaredDifference = 0; squaredDifference <= 255 * 255; ++squaredDifference)
+        {
+            weights[squaredDifference] = Traits::fromWeight(lambda * exp(-squaredDifference / (2 * sigma * sigma)));
+        }
+        return weights;
+    }
+
+    void compute_tlinks(const vector<int> &image,
+                        const vector<int> &objectHistogram,
+                        const vector<int> &backgroundHistogram)
+    {
+        vector<Capacity> sourceWeights, sinkWeights;
+        tlinkTables(objectHistogram, backgroundHistogram, sourceWeights, sinkWeights);
+
+        pending.reserve(pending.size() + 2 * image.size());
+        for (int pixel = 0; pixel < image.size(); ++pixel)
+        {
+            add_tlink(pixel, sourceWeights[image[pixel]], sinkWeights[image[pixel]]);
+        }
+    }
+
+    void compute_nlinks(const vector<int> &image, int width, int height, double sigma, double lambda)
+    {
+        vector<Capacity> weights = nlinkTable(sigma, lambda);
+        auto squaredDifference = [](int a, int b)
+        {
+            return (a - b) * (a - b);
+        };
+
+        pending.reserve(pending.size() + 2 * image.size());
+        for (int y = 0; y < height; ++y)
+        {
+            for (int x = 0; x < width; ++x)
+            {
+                int pixel = y * width + x;
+
+                if (x + 1 < width)
+                {
+                    int neighbor = pixel + 1;
+                    add_nlink(pixel, neighbor, weights[squaredDifference(image[pixel], image[neighbor])]);
+                }
+
+                if (y + 1 < height)
+                {
+                    int neighbor = pixel + width;
+                    add_nlink(pixel, neighbor, weights[squaredDifference(image[pixel], image[neighbor])]);
+                }
+            }
+        }
     }
 
-    void compute_tlinks(const vector<int> &image,
-                        const vector<int> &objectHistogram,
-                        const vector<int> &backgroundHistogram)
+    /**
+     * Monta de uma só vez o CSR da grade 4-conectada de uma imagem, com t-links
+     * em todo pixel (o mesmo grafo de compute_tlinks + compute_nlinks).
+     *
+     * Os pixels são os vértices 0 a width*height-1, a fonte é o vértice
+     * width*height e o sorvedouro o seguinte. Os arcos de cada pixel têm ordem
+     * fixa (fonte, sorvedouro, acima, esquerda, direita, abaixo, omitindo os
+     * vizinhos fora da imagem), então a posição de cada arco e a do seu inverso
+     * são calculadas diretamente, sem arestas pendentes nem contagem de graus.
+     * A fonte e o sorvedouro guardam um arco por pixel, na ordem dos pixels.
+     * O resultado é idêntico, arco a arco, ao de add_tlink/add_nlink.
+     *
+     * Os pesos vêm das tabelas de tlinkTables e nlinkTable, consultadas pela
+     * intensidade e pela diferença ao quadrado; a imagem é percorrida linha a
+     * linha com as linhas vizinhas em ponteiros, num único passe sobre os arcos.
+     *
+     * Só pode ser chamado em um grafo vazio.
+     */
+    void buildGrid(const vector<int> &image, int width, int height,
+                   const vector<Capacity> &sourceWeights,
+                   const vector<Capacity> &sinkWeights,
+                   const vector<Capacity> &nlinkWeights)
     {
-        int maxIntensity = objectHistogram.size();
-        for (int pixel = 0; pixel < image.size(); ++pixel)
+        int n = width * height;
+        if (built || !pending.empty())
         {
-            int intensity = image[pixel];
-            double P_object = max(min(static_cast<double>(objectHistogram[intensity]) / maxIntensity, 1.0), 1e-6);
-            double P_background = max(min(static_cast<double>(backgroundHistogram[intensity]) / maxIntensity, 1.0), 1e-6);
-
-            int sourceWeight = -log(P_object);
-            int sinkWeight = -log(P_background);
+            throw logic_error("BasicGraph::buildGrid: o grafo já tem arestas");
+        }
+        if (source != n || sink != n + 1 || vertices != n + 2 || static_cast<int>(image.size()) != n)
+        {
+            throw invalid_argument("BasicGraph::buildGrid: o grafo precisa ter um vértice por pixel, mais a fonte e o sorvedouro");
+        }
 
-            add_tlink(pixel, sourceWeight, sinkWeight);
+        // Início dos arcos de cada pixel: 2 t-links + vizinhos dentro da imagem
+        firstArc.assign(vertices + 1, 0);
+        int arcCount = 0;
+        for (int y = 0; y < height; ++y)
+        {
+            int vertical = (y > 0) + (y + 1 < height);
+            for (int x = 0; x < width; ++x)
+            {
+                firstArc[y * width + x] = arcCount;
+                arcCount += 2 + vertical + (x > 0) + (x + 1 < width);
+            }
         }
-    }
+        int sourceArcs = arcCount;
+        int sinkArcs = sourceArcs + n;
+        firstArc[source] = sourceArcs;
+        firstArc[sink] = sinkArcs;
+        firstArc[vertices] = sinkArcs + n;
+        arcs.resize(firstArc[vertices]);
 
-    void compute_nlinks(const vector<int> &image, int width, int height, double sigma, double lambda)
-    {
         auto squaredDifference = [](int a, int b)
         {
             return (a - b) * (a - b);
@@ -66,46 +1125,72 @@ public:
 
         for (int y = 0; y < height; ++y)
         {
+            const int *row = &image[y * width];
+            const int *above = y > 0 ? row - width : nullptr;
+            const int *below = y + 1 < height ? row + width : nullptr;
+
             for (int x = 0; x < width; ++x)
             {
                 int pixel = y * width + x;
+                int a = firstArc[pixel];
 
+                arcs[a] = {source, sourceArcs + pixel, 0};
+                arcs[sourceArcs + pixel] = {pixel, a, sourceWeights[row[x]]};
+                arcs[a + 1] = {sink, sinkArcs + pixel, sinkWeights[row[x]]};
+                arcs[sinkArcs + pixel] = {pixel, a + 1, 0};
+                a += 2;
+
+                // O inverso de cada n-link é o arco na direção oposta do vizinho:
+                // "acima" é o 3º arco, "abaixo" o último e "direita" o último ou o penúltimo
+                if (above)
+                {
+                    int neighbor = pixel - width;
+                    arcs[a++] = {neighbor, firstArc[neighbor + 1] - 1, nlinkWeights[squaredDifference(row[x], above[x])]};
+                }
+                if (x > 0)
+                {
+                    int neighbor = pixel - 1;
+                    arcs[a++] = {neighbor, firstArc[neighbor + 1] - 1 - (below != nullptr),
+                                 nlinkWeights[squaredDifference(row[x], row[x - 1])]};
+                }
                 if (x + 1 < width)
                 {
                     int neighbor = pixel + 1;
-                    int weight = static_cast<int>(lambda * exp(-squaredDifference(image[pixel], image[neighbor]) / (2 * sigma * sigma)));
-                    add_nlink(pixel, neighbor, weight);
+                    arcs[a++] = {neighbor, firstArc[neighbor] + 2 + (above != nullptr),
+                                 nlinkWeights[squaredDifference(row[x], row[x + 1])]};
                 }
-
-                if (y + 1 < height)
+                if (below)
                 {
                     int neighbor = pixel + width;
-                    int weight = static_cast<int>(lambda * exp(-squaredDifference(image[pixel], image[neighbor]) / (2 * sigma * sigma)));
-                    add_nlink(pixel, neighbor, weight);
+                    arcs[a++] = {neighbor, firstArc[neighbor] + 2, nlinkWeights[squaredDifference(row[x], below[x])]};
                 }
             }
         }
+
+        built = true;
     }
 
-    bool findAugmentingPath(vector<int> &parent)
+    // BFS no grafo residual; parentArc[v] guarda o arco usado para chegar em v
+    bool findAugmentingPath(vector<int> &parentArc)
     {
         vector<bool> visited(vertices, false);
         queue<int> q;
 
         q.push(source);
         visited[source] = true;
-        parent[source] = -1;
+        parentArc[source] = -1;
 
         while (!q.empty())
         {
             int u = q.front();
             q.pop();
 
-            for (const auto &[v, cap] : capacity[u])
+            for (int a = firstArc[u]; a < firstArc[u + 1]; ++a)
             {
-                if (!visited[v] && cap - flow[u][v] > 0)
+                int v = arcs[a].head;
+                if (!visited[v] && Traits::isPositive(arcs[a].residual))
                 {
-                    parent[v] = u;
+                    parentArc[v] = a;
                     if (v == sink)
                     {
                         return true;
@@ -118,34 +1203,432 @@ public:
         return false;
     }
 
-    int pushFlow(vector<int> &parent)
+    Capacity pushFlow(vector<int> &parentArc)
     {
-        int pathFlow = INT_MAX;
+        Capacity pathFlow = numeric_limits<Capacity>::max();
 
-        for (int v = sink; v != source; v = parent[v])
+        for (int v = sink; v != source;)
         {
-            int u = parent[v];
-            pathFlow = min(pathFlow, capacity[u][v] - flow[u][v]);
+            const Arc &arc = arcs[parentArc[v]];
+            pathFlow = min(pathFlow, arc.residual);
+            v = arcs[arc.reverse].head;
         }
 
-        for (int v = sink; v != source; v = parent[v])
+        for (int v = sink; v != source;)
         {
-            int u = parent[v];
-            flow[u][v] += pathFlow;
-            flow[v][u] -= pathFlow;
+            Arc &arc = arcs[parentArc[v]];
+            arc.residual -= pathFlow;
+            arcs[arc.reverse].residual += pathFlow;
+            v = arcs[arc.reverse].head;
         }
 
         return pathFlow;
     }
 
-    int fordFulkerson(vector<int> &setS, vector<int> &setT)
+    // Edmonds–Karp: cada aumento refaz a BFS a partir da fonte
+    Capacity edmondsKarp()
+    {
+        Capacity maxFlow = 0;
+        vector<int> parentArc(vertices);
+
+        while (findAugmentingPath(parentArc))
+        {
+            maxFlow += pushFlow(parentArc);
+        }
+
+        return maxFlow;
+    }
+
+    // Ativar um nó recomeça a varredura dos seus arcos, pois vizinhos podem ter ficado livres
+    void bkActivate(int v)
+    {
+        bkNextArc[v] = firstArc[v];
+        if (!bkIsActive[v])
+        {
+            bkIsActive[v] = true;
+            bkActive.push_back(v);
+        }
+    }
+
+    // Árvores iniciais: apenas a fonte (S) e o sorvedouro (T), ambos ativos
+    void bkInitialize()
+    {
+        bkTree.assign(vertices, FREE);
+        bkParent.assign(vertices, ORPHAN);
+        bkTimestamp.assign(vertices, 0);
+        bkDist.assign(vertices, 0);
+        bkIsActive.assign(vertices, false);
+        bkNextArc.assign(firstArc.begin(), firstArc.end() - 1);
+        bkActive.clear();
+        bkOrphans.clear();
+        bkTime = 0;
+
+        bkTree[source] = TREE_S;
+        bkParent[source] = TERMINAL;
+        bkTree[sink] = TREE_T;
+        bkParent[sink] = TERMINAL;
+        bkActivate(source);
+        bkActivate(sink);
+    }
+
+    // Adoção: cada órfão procura um novo pai válido na sua árvore ou vira livre
+    void bkAdoptOrphans()
+    {
+        while (!bkOrphans.empty())
+        {
+            int o = bkOrphans.front();
+            bkOrphans.pop_front();
+            if (bkParent[o] != ORPHAN)
+            {
+                continue; // bkTouch já o ligou a um terminal
+            }
+            char t = bkTree[o];
+
+            int bestArc = ORPHAN;
+            int bestDist = INT_MAX;
+            for (int a = firstArc[o]; a < firstArc[o + 1]; ++a)
+            {
+                int q = arcs[a].head;
+                if (bkTree[q] != t || !Traits::isPositive(bkTreeResidual(t, arcs[a].reverse)))
+                {
+                    continue;
+                }
+
+                // Confere se q ainda chega ao terminal, contando a distância
+                int d = 0;
+                int j = q;
+                while (true)
+                {
+                    if (bkTimestamp[j] == bkTime)
+                    {
+                        d += bkDist[j];
+                        break;
+                    }
+                    if (bkParent[j] == TERMINAL)
+                    {
+                        bkTimestamp[j] = bkTime;
+                        bkDist[j] = 0;
+                        break;
+                    }
+                    if (bkParent[j] == ORPHAN)
+                    {
+                        d = INT_MAX;
+                        break;
+                    }
+                    ++d;
+                    j = bkParentVertex(j);
+                }
+
+                if (d == INT_MAX)
+                {
+                    continue;
+                }
+                if (d < bestDist)
+                {
+                    bestDist = d;
+                    bestArc = t == TREE_S ? arcs[a].reverse : a;
+                }
+                for (j = q; bkTimestamp[j] != bkTime; j = bkParentVertex(j))
+                {
+                    bkTimestamp[j] = bkTime;
+                    bkDist[j] = d--;
+                }
+            }
+
+            if (bestArc != ORPHAN)
+            {
+                bkParent[o] = bestArc;
+                bkTimestamp[o] = bkTime;
+                bkDist[o] = bestDist + 1;
+                continue;
+            }
+
+            // Nenhum pai válido: o nó sai da árvore e os vizinhos são reavaliados
+            for (int a = firstArc[o]; a < firstArc[o + 1]; ++a)
+            {
+                int q = arcs[a].head;
+                if (bkTree[q] != t)
+                {
+                    continue;
+                }
+                if (Traits::isPositive(bkTreeResidual(t, arcs[a].reverse)))
+                {
+                    bkActivate(q);
+                }
+                if (bkParent[q] >= 0 && bkParentVertex(q) == o)
+                {
+                    bkParent[q] = ORPHAN;
+                    bkOrphans.push_back(q);
+                }
+            }
+            bkTree[o] = FREE;
+        }
+    }
+
+    /**
+     * Reavalia nas árvores um vértice cujos arcos mudaram de capacidade
+     * (maxflow_reuse_trees_init da biblioteca de Boykov e Kolmogorov).
+     *
+     * Um vértice com resíduo a partir da fonte (ou até o sorvedouro) passa a
+     * ser filho direto desse terminal; se mudou de árvore, os filhos que tinha
+     * na árvore antiga viram órfãos e os vizinhos da árvore antiga com resíduo
+     * até ele são ativados, pois agora formam uma ponte. Nos demais, o arco até o pai pode ter
+     * saturado (órfão). Em todos os casos o vértice é ativado para procurar
+     * caminhos novos; um vértice livre ativa os vizinhos que estão nas árvores.
+     */
+    void bkTouch(int v)
+    {
+        if (!bkReady)
+        {
+            return;
+        }
+
+        int toSource = findArc(v, source);
+        int toSink = findArc(v, sink);
+        int terminalArc = -1;
+        char terminalTree = FREE;
+        if (toSource >= 0 && Traits::isPositive(arcs[arcs[toSource].reverse].residual))
+        {
+            terminalArc = arcs[toSource].reverse;
+            terminalTree = TREE_S;
+        }
+        else if (toSink >= 0 && Traits::isPositive(arcs[toSink].residual))
+        {
+            terminalArc = toSink;
+            terminalTree = TREE_T;
+        }
+
+        if (terminalArc >= 0)
+        {
+            if (bkTree[v] != terminalTree && bkTree[v] != FREE)
+            {
+                char oldTree = bkTree[v];
+                for (int a = firstArc[v]; a < firstArc[v + 1]; ++a)
+                {
+                    int q = arcs[a].head;
+                    if (bkTree[q] != oldTree)
+                    {
+                        continue;
+                    }
+                    // Vizinhos passivos da árvore antiga com resíduo até v agora tocam a outra árvore
+                    if (bkParent[q] != TERMINAL && Traits::isPositive(bkTreeResidual(oldTree, arcs[a].reverse)))
+                    {
+                        bkActivate(q);
+                    }
+                    if (bkParent[q] >= 0 && bkParentVertex(q) == v)
+                    {
+                        bkParent[q] = ORPHAN;
+                        bkOrphans.push_back(q);
+                    }
+                }
+            }
+            bkTree[v] = terminalTree;
+            bkParent[v] = terminalArc;
+            bkTimestamp[v] = bkTime;
+            bkDist[v] = 1;
+            bkActivate(v);
+            return;
+        }
+
+        if (bkTree[v] != FREE)
+        {
+            if (bkParent[v] >= 0 && !Traits::isPositive(arcs[bkParent[v]].residual))
+            {
+                bkParent[v] = ORPHAN;
+                bkOrphans.push_back(v);
+            }
+            bkActivate(v);
+            return;
+        }
+
+        for (int a = firstArc[v]; a < firstArc[v + 1]; ++a)
+        {
+            int q = arcs[a].head;
+            if (bkTree[q] != FREE && bkParent[q] != TERMINAL)
+            {
+                bkActivate(q);
+            }
+        }
+    }
+
+    /**
+     * Algoritmo de Boykov–Kolmogorov ("An Experimental Comparison of Min-Cut/Max-Flow
+     * Algorithms for Energy Minimization in Vision", 2004).
+     *
+     * Mantém duas árvores de busca, S enraizada na fonte e T no sorvedouro, que são
+     * reaproveitadas entre os aumentos: após saturar um caminho, apenas os nós que
+     * perderam o arco até o pai (órfãos) são readotados ou liberados, em vez de
+     * refazer a busca inteira como no Edmonds–Karp.
+     *
+     * As árvores também sobrevivem ao fim da execução: depois de updateTlink e
+     * updateNlink a busca continua das árvores anteriores (Kohli e Torr), tratando
+     * primeiro os órfãos e os nós ativados pelas atualizações.
+     */
+    Capacity boykovKolmogorov()
+    {
+        if (!bkReady)
+        {
+            bkInitialize();
+        }
+        Capacity maxFlow = 0;
+
+        // Distâncias marcadas antes das atualizações não valem mais
+        ++bkTime;
+        bkAdoptOrphans();
+
+        while (!bkActive.empty())
+        {
+            int p = bkActive.front();
+            bkActive.pop_front();
+            bkIsActive[p] = false;
+            if (bkTree[p] == FREE)
+            {
+                continue;
+            }
+
+            // Crescimento: procura um arco que ligue as duas árvores
+            int bridge = -1;
+            int a = bkNextArc[p];
+            for (; a < firstArc[p + 1]; ++a)
+            {
+                if (!Traits::isPositive(bkTreeResidual(bkTree[p], a)))
+                {
+                    continue;
+                }
+                int q = arcs[a].head;
+                if (bkTree[q] == FREE)
+                {
+                    bkTree[q] = bkTree[p];
+                    bkParent[q] = bkTree[p] == TREE_S ? a : arcs[a].reverse;
+                    bkTimestamp[q] = bkTimestamp[p];
+                    bkDist[q] = bkDist[p] + 1;
+                    bkActivate(q);
+                }
+                else if (bkTree[q] != bkTree[p])
+                {
+                    bridge = bkTree[p] == TREE_S ? a : arcs[a].reverse;
+                    break;
+                }
+                else if (bkTimestamp[q] <= bkTimestamp[p] && bkDist[q] > bkDist[p])
+                {
+                    // Heurística: troca o pai de q por p, que está mais perto do terminal
+                    bkParent[q] = bkTree[p] == TREE_S ? a : arcs[a].reverse;
+                    bkTimestamp[q] = bkTimestamp[p];
+                    bkDist[q] = bkDist[p] + 1;
+                }
+            }
+
+            if (bridge < 0)
+            {
+                continue;
+            }
+
+            // p ainda pode ter outros caminhos; volta para a fila de ativos a partir do mesmo arco
+            bkNextArc[p] = a;
+            bkIsActive[p] = true;
+            bkActive.push_front(p);
+            ++bkTime;
+
+            // Aumento: gargalo no caminho fonte -> ... -> bridge -> ... -> sorvedouro
+            Capacity pathFlow = arcs[bridge].residual;
+            for (int v = arcs[arcs[bridge].reverse].head; bkParent[v] != TERMINAL; v = bkParentVertex(v))
+            {
+                pathFlow = min(pathFlow, arcs[bkParent[v]].residual);
+            }
+            for (int v = arcs[bridge].head; bkParent[v] != TERMINAL; v = bkParentVertex(v))
+            {
+                pathFlow = min(pathFlow, arcs[bkParent[v]].residual);
+            }
+
+            arcs[bridge].residual -= pathFlow;
+            arcs[arcs[bridge].reverse].residual += pathFlow;
+            for (int v = arcs[arcs[bridge].reverse].head; bkParent[v] != TERMINAL;)
+            {
+                Arc &arc = arcs[bkParent[v]];
+                int next = bkParentVertex(v);
+                arc.residual -= pathFlow;
+                arcs[arc.reverse].residual += pathFlow;
+                if (!Traits::isPositive(arc.residual))
+                {
+                    bkParent[v] = ORPHAN;
+                    bkOrphans.push_front(v);
+                }
+                v = next;
+            }
+            for (int v = arcs[bridge].head; bkParent[v] != TERMINAL;)
+            {
+                Arc &arc = arcs[bkParent[v]];
+                int next = bkParentVertex(v);
+                arc.residual -= pathFlow;
+                arcs[arc.reverse].residual += pathFlow;
+                if (!Traits::isPositive(arc.residual))
+                {
+                    bkParent[v] = ORPHAN;
+                    bkOrphans.push_front(v);
+                }
+                v = next;
+            }
+            maxFlow += pathFlow;
+
+            bkAdoptOrphans();
+        }
+
+        return maxFlow;
+    }
+
+    /**
+     * Push-relabel (Goldberg–Tarjan) com seleção FIFO, global relabel periódico
+     * por BFS reversa a partir do sorvedouro e heurística de gap.
+     *
+     * Em grades com muitos t-links os caminhos aumentantes são curtos porém
+     * numerosos, cenário em que o push-relabel costuma superar os métodos de
+     * caminhos aumentantes. Os contadores ficam disponíveis em getStats().
+     *
+     * Com parallel = true a fase 1 e os seus global relabels usam as threads
+     * configuradas em setThreads. A fase 2 e a extração do corte continuam
+     * seriais, o que limita o speedup: com uma thread o motor paralelo é mais
+     * lento que o serial (não tem gap nem current-arc), por isso com
+     * setThreads(1) o motor serial é usado.
+     */
+    Capacity pushRelabel(bool parallel = false)
     {
-        int maxFlow = 0;
-        vector<int> parent(vertices);
+        auto start = chrono::steady_clock::now();
+        if (parallel && threadCount > 1)
+        {
+            prParallelMaximumPreflow(threadCount);
+        }
+        else
+        {
+            prMaximumPreflow();
+        }
+        auto middle = chrono::steady_clock::now();
+        prReturnExcess();
+        auto end = chrono::steady_clock::now();
+
+        stats.phase1Seconds = chrono::duration<double>(middle - start).count();
+        stats.phase2Seconds = chrono::duration<double>(end - middle).count();
+
+        Capacity maxFlow = excess[sink];
+        vector<Capacity>().swap(excess);
+        vector<int>().swap(label);
+        vector<int>().swap(currentArc);
+        vector<int>().swap(labelCount);
+        return maxFlow;
+    }
 
-        while (findAugmentingPath(parent))
+    // Separa os vértices alcançáveis a partir da fonte no grafo residual (lado S do corte)
+    // Os pixels fixados por sementes ficam no lado da sua semente
+    void extractCut(vector<int> &setS, vector<int> &setT)
+    {
+        // Ao fim do Boykov–Kolmogorov a árvore S é exatamente esse conjunto
+        if (bkReady)
         {
-            maxFlow += pushFlow(parent);
+            for (int i = 0; i < vertices; ++i)
+            {
+                char side = isPinned(i) ? pinned[i] : bkTree[i];
+                (side == TREE_S ? setS : setT).push_back(i);
+            }
+            return;
         }
 
         vector<bool> visited(vertices, false);
@@ -158,9 +1641,10 @@ public:
             int u = q.front();
             q.pop();
 
-            for (const auto &[v, cap] : capacity[u])
+            for (int a = firstArc[u]; a < firstArc[u + 1]; ++a)
             {
-                if (!visited[v] && cap - flow[u][v] > 0)
+                int v = arcs[a].head;
+                if (!visited[v] && Traits::isPositive(arcs[a].residual))
                 {
                     visited[v] = true;
                     q.push(v);
@@ -170,7 +1654,7 @@ public:
 
         for (int i = 0; i < vertices; ++i)
         {
-            if (visited[i])
+            if (isPinned(i) ? pinned[i] == TREE_S : visited[i])
             {
                 setS.push_back(i);
             }
@@ -179,7 +1663,248 @@ public:
                 setT.push_back(i);
             }
         }
+    }
 
-        return maxFlow;
+    /**
+     * Bytes por pixel de um grafo de grade montado por buildGrid e resolvido
+     * pelo Boykov–Kolmogorov: os 8 arcos e o firstArc do CSR, mais o estado das
+     * árvores de busca e a marca de pinSeeds. Usado para caber um grafo em um
+     * orçamento de memória.
+     */
+    static constexpr size_t gridBytesPerPixel()
+    {
+        return 8 * sizeof(Arc) + sizeof(int)        // CSR
+               + 4 * sizeof(int) + 2 * sizeof(char) // bkParent, bkTimestamp, bkDist, bkNextArc, bkTree, bkIsActive
+               + sizeof(char);                      // pinned
+    }
+
+    void setEngine(MaxFlowEngine newEngine)
+    {
+        engine = newEngine;
+    }
+
+    // Quantidade de threads do motor ParallelPushRelabel (padrão: todos os núcleos; com 1, usa o push-relabel serial)
+    void setThreads(int threads)
+    {
+        threadCount = max(1, threads);
+    }
+
+    const MaxFlowStats &getStats() const
+    {
+        return stats;
+    }
+
+    /**
+     * Corte dinâmico (Kohli e Torr, "Efficiently Solving Dynamic Markov Random
+     * Fields Using Graph Cuts", 2005): troca os pesos dos t-links de um pixel
+     * de um grafo já resolvido, mantendo o fluxo atual. A próxima chamada de
+     * fordFulkerson continua desse fluxo (e das árvores do Boykov–Kolmogorov),
+     * em vez de recomeçar do zero.
+     */
+    void updateTlink(int pixel, Capacity sourceWeight, Capacity sinkWeight)
+    {
+        build();
+        if (isPinned(pixel))
+        {
+            throw invalid_argument("BasicGraph::updateTlink: o pixel está fixado por uma semente");
+        }
+        Capacity oldSource, oldSink, sourceFlow, sinkFlow;
+        tlinkState(pixel, oldSource, oldSink, sourceFlow, sinkFlow);
+        setTlinkFlow(pixel, sourceWeight, sinkWeight, sourceFlow, sinkFlow);
+        bkTouch(pixel);
+    }
+
+    /**
+     * Corte dinâmico: troca o peso do n-link entre dois pixels (nos dois
+     * sentidos, como add_nlink), mantendo o fluxo atual.
+     *
+     * Se o fluxo que passa pelo n-link é maior que o novo peso, o excesso deixa
+     * de passar por ele: o pixel de origem o entrega ao sorvedouro e o de
+     * destino passa a recebê-lo da fonte, pelos t-links reparametrizados.
+     */
+    void updateNlink(int pixel1, int pixel2, Capacity weight)
+    {
+        build();
+        if (isPinned(pixel1) || isPinned(pixel2))
+        {
+            throw invalid_argument("BasicGraph::updateNlink: o pixel está fixado por uma semente");
+        }
+        int forward = findArc(pixel1, pixel2);
+        if (forward < 0)
+        {
+            throw invalid_argument("BasicGraph::updateNlink: os pixels não são vizinhos");
+        }
+        Arc &arc = arcs[forward];
+        Arc &reverse = arcs[arc.reverse];
+
+        // Resíduos de um n-link simétrico: peso - fluxo e peso + fluxo
+        Capacity pairFlow = (reverse.residual - arc.residual) / 2; // fluxo líquido pixel1 -> pixel2
+        int from = pixel1, to = pixel2;
+        Capacity excessFlow = pairFlow - weight;
+        if (pairFlow < 0)
+        {
+            from = pixel2;
+            to = pixel1;
+            excessFlow = -pairFlow - weight;
+        }
+
+        if (excessFlow > 0)
+        {
+            pairFlow += pairFlow > 0 ? -excessFlow : excessFlow;
+
+            Capacity sourceWeight, sinkWeight, sourceFlow, sinkFlow;
+            tlinkState(from, sourceWeight, sinkWeight, sourceFlow, sinkFlow);
+            setTlinkFlow(from, sourceWeight, sinkWeight, sourceFlow, sinkFlow + excessFlow);
+            tlinkState(to, sourceWeight, sinkWeight, sourceFlow, sinkFlow);
+            setTlinkFlow(to, sourceWeight, sinkWeight, sourceFlow + excessFlow, sinkFlow);
+            flow += excessFlow;
+        }
+
+        arc.residual = weight - pairFlow;
+        reverse.residual = weight + pairFlow;
+        bkTouch(pixel1);
+        bkTouch(pixel2);
+    }
+
+    /**
+     * Fixa pixels no objeto (lado da fonte) ou no fundo (lado do sorvedouro)
+     * pelas máscaras de sementes, indexadas pelo vértice do pixel. Deve ser
+     * chamado antes de fordFulkerson; um pixel não pode estar nas duas máscaras.
+     *
+     * Cada semente equivale a um t-link de capacidade infinita até o seu
+     * terminal. Em vez de representar esse infinito, o pixel é contraído no
+     * terminal: o arco até um vizinho livre que o corte pagaria passa a somar no
+     * t-link do vizinho, os arcos que todo corte paga (até o terminal oposto ou
+     * até uma semente do outro lado) vão para pinnedCut, e todos os arcos do
+     * pixel ficam com capacidade zero. Assim nenhum motor explora os pixels
+     * fixados, que só voltam ao resultado em extractCut.
+     */
+    void pinSeeds(const vector<bool> &objectSeeds, const vector<bool> &backgroundSeeds)
+    {
+        build();
+        int pixels = objectSeeds.size();
+        if (solved)
+        {
+            throw logic_error("BasicGraph::pinSeeds: o grafo já foi resolvido");
+        }
+        if (static_cast<int>(backgroundSeeds.size()) != pixels || source < pixels || sink < pixels)
+        {
+            throw invalid_argument("BasicGraph::pinSeeds: as máscaras precisam ter um valor por pixel");
+        }
+
+        pinned.assign(pixels, FREE);
+        for (int p = 0; p < pixels; ++p)
+        {
+            if (objectSeeds[p] && backgroundSeeds[p])
+            {
+                throw invalid_argument("BasicGraph::pinSeeds: pixel marcado como objeto e fundo");
+            }
+            pinned[p] = objectSeeds[p] ? TREE_S : backgroundSeeds[p] ? TREE_T : FREE;
+        }
+
+        // Um arco entre dois pixels fixados é zerado pelo primeiro deles; o corte dos dois sentidos é contado ali
+        for (int p = 0; p < pixels; ++p)
+        {
+            if (pinned[p] == FREE)
+            {
+                continue;
+            }
+            bool objectSide = pinned[p] == TREE_S;
+
+            for (int a = firstArc[p]; a < firstArc[p + 1]; ++a)
+            {
+                Arc &arc = arcs[a];
+                Arc &reverse = arcs[arc.reverse];
+                int q = arc.head;
+
+                if (q == source || q == sink)
+                {
+                    // Só o t-link do terminal oposto é cortado
+                    if (objectSide && q == sink)
+                    {
+                        pinnedCut += arc.residual;
+                    }
+                    else if (!objectSide && q == source)
+                    {
+                        pinnedCut += reverse.residual;
+                    }
+                }
+                else if (isPinned(q))
+                {
+                    if (pinned[q] != pinned[p])
+                    {
+                        pinnedCut += objectSide ? arc.residual : reverse.residual;
+                    }
+                }
+                else if (objectSide)
+                {
+                    // p -> q é cortado quando q fica no fundo: vira o t-link fonte -> q
+                    int toSource = findArc(q, source);
+                    if (toSource < 0)
+                    {
+                        throw invalid_argument("BasicGraph::pinSeeds: o vizinho da semente não tem t-links");
+                    }
+                    arcs[arcs[toSource].reverse].residual += arc.residual;
+                }
+                else
+                {
+                    // q -> p é cortado quando q fica no objeto: vira o t-link q -> sorvedouro
+                    int toSink = findArc(q, sink);
+                    if (toSink < 0)
+                    {
+                        throw invalid_argument("BasicGraph::pinSeeds: o vizinho da semente não tem t-links");
+                    }
+                    arcs[toSink].residual += reverse.residual;
+                }
+
+                arc.residual = 0;
+                reverse.residual = 0;
+            }
+        }
     }
-};
\ No newline at end of file
+
+    /**
+     * Calcula o fluxo máximo com o motor selecionado e devolve o corte mínimo.
+     *
+     * O lado S é sempre o conjunto de vértices alcançáveis a partir da fonte no
+     * grafo residual final, que é o mesmo para qualquer fluxo máximo; por isso
+     * todos os motores produzem exatamente o mesmo corte.
+     *
+     * O fluxo é acumulado entre chamadas: depois de updateTlink/updateNlink a
+     * chamada seguinte só procura o fluxo que falta. O valor devolvido é o do
+     * corte mínimo com os pesos atuais (sem as reparametrizações), incluindo os
+     * arcos das sementes fixadas por pinSeeds.
+     */
+    Capacity fordFulkerson(vector<int> &setS, vector<int> &setT)
+    {
+        build();
+        stats = MaxFlowStats();
+
+        // Só o Boykov–Kolmogorov mantém as árvores em dia com o grafo residual
+        bkReady = bkReady && engine == MaxFlowEngine::BoykovKolmogorov;
+        switch (engine)
+        {
+        case MaxFlowEngine::EdmondsKarp:
+            flow += edmondsKarp();
+            break;
+        case MaxFlowEngine::BoykovKolmogorov:
+            flow += boykovKolmogorov();
+            bkReady = true;
+            break;
+        case MaxFlowEngine::PushRelabel:
+            flow += pushRelabel();
+            break;
+        case MaxFlowEngine::ParallelPushRelabel:
+            flow += pushRelabel(true);
+            break;
+        }
+
+        solved = true;
+        extractCut(setS, setT);
+        return flow - shift + pinnedCut;
+    }
+};
+
+using Graph = BasicGraph<int>;               // pesos truncados para inteiro
+using FixedPointGraph = BasicGraph<int64_t>; // pesos em ponto fixo (16 bits de fração)
+using FloatGraph = BasicGraph<float>;        // pesos em float, com tolerância EPSILON
@@ -9,7 +9,14 @@
 #include <cstdlib>
 #include <limits>
 #include <unordered_map>
-#include "graph.cpp"
+#include <chrono>
+#include "Graph.cpp"
+#include "../common/PgmReader.hpp"
+#include "../common/PgmWriter.hpp"
+
+#if defined(__unix__) || defined(__APPLE__)
+    #include <sys/resource.h>
+#endif
 
 using namespace std;
 
@@ -28,78 +35,51 @@ vector<bool> createSegmentationMask(int width, int height, const std::vector<int
     return segmentationMask;
 }
 
-vector<int> readPixelsLine(ifstream &file, int width)
-{
-    vector<int> pixels(width);
-    for (int i = 0; i < width; ++i)
-    {
-        file >> pixels[i];
-    }
-    return pixels;
-}
-
+// Lê uma imagem PGM (P2 ou P5, 8 ou 16 bits) em tons de cinza de 0 a 255
 vector<int> readPGM(const string &filename, int &width, int &height)
 {
-    ifstream file(filename);
-    if (!file.is_open())
-    {
-        throw runtime_error("Não foi possível abrir o arquivo.");
-    }
+    Image<uint8_t> pgm = loadPGM<uint8_t>(filename);
+    width = pgm.getWidth();
+    height = pgm.getHeight();
 
-    string line;
-    getline(file, line);
-    if (line != "P2")
+    vector<int> pixels(width * height);
+    for (int y = 0; y < height; ++y)
     {
-        throw runtime_error("Formato não suportado. Apenas P2 é suportado.");
+        const uint8_t *row = pgm.row(y);
+        copy(row, row + width, pixels.begin() + y * width);
     }
 
-    while (getline(file, line) && line[0] == '#')
-        ;
-
-    istringstream dimensions(line);
-    dimensions >> width >> height;
-
-    int maxVal;
-    file >> maxVal;
+    return pixels;
+}
 
-    vector<int> pixels(width * height);
+struct RGBPixel
+{
+    uint8_t r, g, b;
+};
 
-    int index = 0;
-    while (index < width * height)
+// Grava a máscara como PPM binário (P6): objeto em azul, fundo em vermelho, com a intensidade original
+void MaskToPPM(const vector<bool>& a, const vector<int>& matrix, int width, int height, const string& filename,
+                 PnmWriteMode mode = PnmWriteMode::Buffered)
+{
+    Image<RGBPixel> colored(width, height);
+    for (int y = 0; y < height; ++y)
     {
-        vector<int> linePixels = readPixelsLine(file, width);
-        for (int i = 0; i < width; ++i)
+        RGBPixel *row = colored.row(y);
+        for (int x = 0; x < width; ++x)
         {
-            pixels[index++] = linePixels[i];
+            int index = y * width + x;
+            uint8_t value = static_cast<uint8_t>(matrix[index]);
+            row[x] = a[index] ? RGBPixel{0, 0, value} : RGBPixel{value, 0, 0};
         }
     }
 
-    file.close();
-    return pixels;
-}
-
-void MatrixToPGM(const vector<bool>& a, const vector<int>& matrix, int width, int height, const string& filename) {
-    ofstream file(filename);
-
-    if (file.is_open()) {
-        file << "P2" << endl;
-        file << width << " " << height << endl;
-        file << "255" << endl;
-
-        for (int i = 0; i < height; ++i) {
-            for (int j = 0; j < width; ++j) {
-                int index = i * width + j;
-
-                if (a[index]) {
-                    file << " 0 0 " << matrix[index] << " ";
-                } else {
-                    file << " " << matrix[index] << " 0 0 ";
-                }
-            }
-            file << endl;
-        }
-    } else {
-        cout << "Erro ao abrir o arquivo!" << endl;
+    try
+    {
+        savePPM<RGBPixel>(filename, colored, mode);
+    }
+    catch (const runtime_error &e)
+    {
+        cout << "Erro ao abrir o arquivo! (" << e.what() << ")" << endl;
     }
 }
 
@@ -130,31 +110,285 @@ void computeHistograms(const vector<int> &image, vector<int> &objectHistogram, v
     }
 }
 
-int main()
+// Histogramas apenas dos pixels marcados como sementes de objeto e de fundo
+void computeSeedHistograms(const vector<int> &image, const vector<bool> &objectSeeds, const vector<bool> &backgroundSeeds,
+                           vector<int> &objectHistogram, vector<int> &backgroundHistogram)
 {
-    int width = 150;
-    int height = 150;
+    objectHistogram.assign(256, 0);
+    backgroundHistogram.assign(256, 0);
 
-    vector<int> image = readPGM("teste.pgm", width, height);
+    for (size_t pixel = 0; pixel < image.size(); ++pixel)
+    {
+        if (objectSeeds[pixel])
+        {
+            objectHistogram[image[pixel]]++;
+        }
+        else if (backgroundSeeds[pixel])
+        {
+            backgroundHistogram[image[pixel]]++;
+        }
+    }
+}
 
+// Monta o grafo de segmentação (t-links pelos histogramas, n-links pela vizinhança 4-conectada)
+template <typename Capacity>
+void buildSegmentationGraph(BasicGraph<Capacity> &graph, const vector<int> &image, int width, int height, double sigma, double lambda)
+{
     vector<int> objectHistogram(256, 0);
     vector<int> backgroundHistogram(256, 0);
 
     computeHistograms(image, objectHistogram, backgroundHistogram);
 
-    double sigma = 100.0;
-    double lambda = 20.0;
+    vector<Capacity> sourceWeights, sinkWeights;
+    BasicGraph<Capacity>::tlinkTables(objectHistogram, backgroundHistogram, sourceWeights, sinkWeights);
+    graph.buildGrid(image, width, height, sourceWeights, sinkWeights, BasicGraph<Capacity>::nlinkTable(sigma, lambda));
+}
+
+/**
+ * Monta o grafo de segmentação com sementes (rabiscos do usuário): os
+ * histogramas vêm só dos pixels marcados e os pixels marcados ficam presos ao
+ * seu lado do corte (BasicGraph::pinSeeds). Sem sementes de objeto ou sem
+ * sementes de fundo os histogramas voltam a ser separados pela média global.
+ */
+template <typename Capacity>
+void buildSeededSegmentationGraph(BasicGraph<Capacity> &graph, const vector<int> &image, int width, int height,
+                                  const vector<bool> &objectSeeds, const vector<bool> &backgroundSeeds,
+                                  double sigma, double lambda)
+{
+    vector<int> objectHistogram, backgroundHistogram;
+    bool hasObject = find(objectSeeds.begin(), objectSeeds.end(), true) != objectSeeds.end();
+    bool hasBackground = find(backgroundSeeds.begin(), backgroundSeeds.end(), true) != backgroundSeeds.end();
+    if (hasObject && hasBackground)
+    {
+        computeSeedHistograms(image, objectSeeds, backgroundSeeds, objectHistogram, backgroundHistogram);
+    }
+    else
+    {
+        computeHistograms(image, objectHistogram, backgroundHistogram);
+    }
+
+    vector<Capacity> sourceWeights, sinkWeights;
+    BasicGraph<Capacity>::tlinkTables(objectHistogram, backgroundHistogram, sourceWeights, sinkWeights);
+    graph.buildGrid(image, width, height, sourceWeights, sinkWeights, BasicGraph<Capacity>::nlinkTable(sigma, lambda));
+    graph.pinSeeds(objectSeeds, backgroundSeeds);
+}
 
+// Segmenta a imagem com sementes de objeto e de fundo e devolve a máscara do objeto
+template <typename Capacity>
+vector<bool> segmentWithSeeds(const vector<int> &image, int width, int height,
+                              const vector<bool> &objectSeeds, const vector<bool> &backgroundSeeds,
+                              double sigma, double lambda)
+{
     int source = width * height;
     int sink = source + 1;
+    BasicGraph<Capacity> graph(source + 2, source, sink);
+    buildSeededSegmentationGraph(graph, image, width, height, objectSeeds, backgroundSeeds, sigma, lambda);
 
-    Graph graph(source + 2, source, sink);
+    vector<int> setS, setT;
+    graph.fordFulkerson(setS, setT);
+    return createSegmentationMask(width, height, setS, setT);
+}
 
-    graph.compute_tlinks(image, objectHistogram, backgroundHistogram);
-    graph.compute_nlinks(image, width, height, sigma, lambda);
+// Lê uma máscara de sementes em PGM do mesmo tamanho da imagem (pixels diferentes de 0 são sementes)
+vector<bool> readSeedMask(const string &filename, int width, int height)
+{
+    int maskWidth, maskHeight;
+    vector<int> pixels = readPGM(filename, maskWidth, maskHeight);
+    if (maskWidth != width || maskHeight != height)
+    {
+        throw runtime_error(filename + ": a máscara de sementes não tem o tamanho da imagem");
+    }
+
+    vector<bool> mask(pixels.size());
+    for (size_t pixel = 0; pixel < pixels.size(); ++pixel)
+    {
+        mask[pixel] = pixels[pixel] != 0;
+    }
+    return mask;
+}
+
+/**
+ * Compara os motores de fluxo máximo em cada imagem PGM recebida.
+ *
+ * Para cada imagem o grafo é montado do zero para cada motor, o tempo de
+ * fordFulkerson é medido e o corte resultante é comparado com o do
+ * Edmonds–Karp (BFS), que serve de referência para o speedup. Para o
+ * push-relabel também são exibidos os contadores de cada fase.
+ */
+template <typename Capacity>
+void benchmarkEngines(const vector<string> &filenames, double sigma, double lambda)
+{
+    const pair<MaxFlowEngine, string> engines[] = {
+        {MaxFlowEngine::EdmondsKarp, "Edmonds-Karp"},
+        {MaxFlowEngine::BoykovKolmogorov, "Boykov-Kolmogorov"},
+        {MaxFlowEngine::PushRelabel, "Push-relabel"},
+        {MaxFlowEngine::ParallelPushRelabel, "Push-relabel paralelo"},
+    };
+
+    for (const string &filename : filenames)
+    {
+        int width, height;
+        vector<int> image = readPGM(filename, width, height);
+        cout << filename << " (" << width << "x" << height << ")" << endl;
+
+        vector<int> referenceS;
+        double referenceSeconds = 0.0;
+        for (const auto &[engine, name] : engines)
+        {
+            int source = width * height;
+            int sink = source + 1;
+            BasicGraph<Capacity> graph(source + 2, source, sink);
+            graph.setEngine(engine);
+            buildSegmentationGraph(graph, image, width, height, sigma, lambda);
+
+            vector<int> setS, setT;
+            auto start = chrono::steady_clock::now();
+            Capacity maxFlow = graph.fordFulkerson(setS, setT);
+            double seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+
+            if (engine == MaxFlowEngine::EdmondsKarp)
+            {
+                referenceS = setS;
+                referenceSeconds = seconds;
+            }
+
+            cout << "  " << name << ": fluxo " << CapacityTraits<Capacity>::toWeight(maxFlow) << ", " << seconds << " s"
+                 << ", speedup " << referenceSeconds / seconds << "x"
+                 << (setS == referenceS ? "" : " (CORTE DIFERENTE!)") << endl;
+
+            if (engine == MaxFlowEngine::PushRelabel || engine == MaxFlowEngine::ParallelPushRelabel)
+            {
+                const MaxFlowStats &stats = graph.getStats();
+                cout << "    pushes " << stats.pushes << ", relabels " << stats.relabels
+                     << ", global relabels " << stats.globalRelabels << " (" << stats.globalRelabelSeconds << " s)"
+                     << ", gap " << stats.gapNodes
+                     << ", fase 1 " << stats.phase1Seconds << " s, fase 2 " << stats.phase2Seconds << " s" << endl;
+            }
+        }
+    }
+}
+
+/**
+ * Mede o corte dinâmico em cada imagem PGM recebida, simulando duas edições
+ * da ferramenta de anotação sobre um grafo já resolvido:
+ * - sementes: um retângulo no centro da imagem (1/10 de cada lado) passa a ser objeto;
+ * - lambda: todos os n-links são recalculados com lambda * 1.25.
+ *
+ * Cada edição é aplicada com updateTlink/updateNlink e resolvida a partir do
+ * fluxo anterior; o tempo é comparado com montar e resolver o grafo do zero,
+ * e os dois cortes são conferidos.
+ */
+template <typename Capacity>
+void benchmarkDynamicCut(const vector<string> &filenames, double sigma, double lambda)
+{
+    using Clock = chrono::steady_clock;
+    auto seconds = [](Clock::time_point start)
+    {
+        return chrono::duration<double>(Clock::now() - start).count();
+    };
+    const Capacity seedWeight = CapacityTraits<Capacity>::fromWeight(1000.0);
+
+    for (const string &filename : filenames)
+    {
+        int width, height;
+        vector<int> image = readPGM(filename, width, height);
+        cout << filename << " (" << width << "x" << height << ")" << endl;
+
+        int source = width * height;
+        int sink = source + 1;
+        int x0 = width * 9 / 20, x1 = width * 11 / 20;
+        int y0 = height * 9 / 20, y1 = height * 11 / 20;
+
+        auto applySeeds = [&](BasicGraph<Capacity> &graph)
+        {
+            for (int y = y0; y < y1; ++y)
+            {
+                for (int x = x0; x < x1; ++x)
+                {
+                    graph.updateTlink(y * width + x, seedWeight, 0);
+                }
+            }
+        };
+        auto applyLambda = [&](BasicGraph<Capacity> &graph, double newLambda)
+        {
+            vector<Capacity> weights = BasicGraph<Capacity>::nlinkTable(sigma, newLambda);
+            for (int y = 0; y < height; ++y)
+            {
+                for (int x = 0; x < width; ++x)
+                {
+                    int pixel = y * width + x;
+                    if (x + 1 < width)
+                    {
+                        int d = image[pixel] - image[pixel + 1];
+                        graph.updateNlink(pixel, pixel + 1, weights[d * d]);
+                    }
+                    if (y + 1 < height)
+                    {
+                        int d = image[pixel] - image[pixel + width];
+                        graph.updateNlink(pixel, pixel + width, weights[d * d]);
+                    }
+                }
+            }
+        };
+
+        BasicGraph<Capacity> graph(source + 2, source, sink);
+        vector<int> setS, setT;
+        auto start = Clock::now();
+        buildSegmentationGraph(graph, image, width, height, sigma, lambda);
+        graph.fordFulkerson(setS, setT);
+        cout << "  corte inicial: " << seconds(start) << " s" << endl;
+
+        const char *edits[] = {"sementes", "lambda"};
+        for (int edit = 0; edit < 2; ++edit)
+        {
+            start = Clock::now();
+            if (edit == 0)
+            {
+                applySeeds(graph);
+            }
+            else
+            {
+                applyLambda(graph, lambda * 1.25);
+            }
+            setS.clear();
+            setT.clear();
+            Capacity cut = graph.fordFulkerson(setS, setT);
+            double incremental = seconds(start);
+
+            // O mesmo grafo montado e resolvido do zero
+            start = Clock::now();
+            BasicGraph<Capacity> fresh(source + 2, source, sink);
+            buildSegmentationGraph(fresh, image, width, height, sigma, edit == 0 ? lambda : lambda * 1.25);
+            applySeeds(fresh);
+            vector<int> freshS, freshT;
+            fresh.fordFulkerson(freshS, freshT);
+            double full = seconds(start);
+
+            cout << "  " << edits[edit] << ": incremental " << incremental << " s, do zero " << full << " s"
+                 << ", speedup " << full / incremental << "x, corte " << CapacityTraits<Capacity>::toWeight(cut)
+                 << (setS == freshS ? "" : " (CORTE DIFERENTE!)") << endl;
+        }
+    }
+}
+
+// Segmenta teste.pgm e grava segmented_output.ppm
+template <typename Capacity>
+void segmentTestImage(double sigma, double lambda)
+{
+    int width = 150;
+    int height = 150;
+
+    vector<int> image = readPGM("teste.pgm", width, height);
+
+    int source = width * height;
+    int sink = source + 1;
+
+    BasicGraph<Capacity> graph(source + 2, source, sink);
+
+    buildSegmentationGraph(graph, image, width, height, sigma, lambda);
 
     vector<int> setS, setT;
-    int maxFlow = graph.fordFulkerson(setS, setT);
+    graph.fordFulkerson(setS, setT);
 
     vector<bool> segmentationMask = createSegmentationMask(width, height, setS, setT);
 
@@ -169,7 +403,486 @@ int main()
         cout << endl;
     }
 
-    MatrixToPGM(segmentationMask, image, width, height, "segmented_output.pgm");
+    MaskToPPM(segmentationMask, image, width, height, "segmented_output.ppm");
+}
+
+/**
+ * Segmenta a imagem (teste.pgm por padrão) com as sementes das máscaras de
+ * objeto e de fundo, grava segmented_output.ppm e compara o tempo com o do
+ * mesmo grafo sem fixar as sementes (apenas com os histogramas delas).
+ */
+template <typename Capacity>
+void segmentSeededImage(const string &objectFile, const string &backgroundFile, const string &filename,
+                        double sigma, double lambda)
+{
+    using Clock = chrono::steady_clock;
+    int width, height;
+    vector<int> image;
+    vector<bool> objectSeeds, backgroundSeeds;
+    try
+    {
+        image = readPGM(filename, width, height);
+        objectSeeds = readSeedMask(objectFile, width, height);
+        backgroundSeeds = readSeedMask(backgroundFile, width, height);
+    }
+    catch (const runtime_error &e)
+    {
+        cerr << e.what() << endl;
+        return;
+    }
+
+    auto start = Clock::now();
+    vector<bool> segmentationMask = segmentWithSeeds<Capacity>(image, width, height, objectSeeds, backgroundSeeds, sigma, lambda);
+    double seededSeconds = chrono::duration<double>(Clock::now() - start).count();
+
+    // Mesmos histogramas, mas sem fixar os pixels marcados
+    start = Clock::now();
+    BasicGraph<Capacity> graph(width * height + 2, width * height, width * height + 1);
+    vector<int> objectHistogram, backgroundHistogram;
+    computeSeedHistograms(image, objectSeeds, backgroundSeeds, objectHistogram, backgroundHistogram);
+    vector<Capacity> sourceWeights, sinkWeights;
+    BasicGraph<Capacity>::tlinkTables(objectHistogram, backgroundHistogram, sourceWeights, sinkWeights);
+    graph.buildGrid(image, width, height, sourceWeights, sinkWeights, BasicGraph<Capacity>::nlinkTable(sigma, lambda));
+    vector<int> setS, setT;
+    graph.fordFulkerson(setS, setT);
+    double unpinnedSeconds = chrono::duration<double>(Clock::now() - start).count();
+
+    cout << filename << " (" << width << "x" << height << "): com sementes fixadas " << seededSeconds
+         << " s, só com os histogramas das sementes " << unpinnedSeconds << " s" << endl;
+
+    MaskToPPM(segmentationMask, image, width, height, "segmented_output.ppm");
+}
+
+// Parâmetros de segmentTiled
+struct TiledCutOptions
+{
+    size_t memoryBudget = size_t(256) << 20; // pico de memória dos grafos residentes, em bytes
+    int overlap = 16;                        // margem de cada tile e meia largura das faixas das costuras
+    int threads = 1;                         // tiles resolvidas ao mesmo tempo (dividem o orçamento)
+    int seamPasses = 2;                      // máximo de passadas ao longo das costuras
+};
+
+// Resultado de segmentTiled
+struct TiledCutStats
+{
+    int tileSize = 0;              // lado do núcleo de cada tile, sem as margens
+    int tilesX = 0, tilesY = 0;    // tiles em cada direção
+    vector<long long> seamChanges; // pixels que mudaram de lado em cada passada das costuras
+};
+
+// Retângulo [x0, x1) x [y0, y1) da imagem
+struct TileRect
+{
+    int x0, y0, x1, y1;
+
+    int pixels() const { return (x1 - x0) * (y1 - y0); }
+    bool contains(int x, int y) const { return x >= x0 && x < x1 && y >= y0 && y < y1; }
+};
+
+// Memória reaproveitada por uma thread de segmentTiled de um bloco para o seguinte
+template <typename Capacity>
+struct TileWorkspace
+{
+    BasicGraph<Capacity> graph{0, 0, 0};
+    vector<int> pixels;
+    vector<int> setS, setT;
+};
+
+/**
+ * Bytes por pixel de um bloco resolvido por solveBlock: o grafo
+ * (BasicGraph::gridBytesPerPixel), os pixels do bloco, setS e setT (que
+ * juntos chegam a 2 ints por pixel, pois cada um guarda a capacidade do
+ * maior lado já visto), as filas de ativos e órfãos do Boykov–Kolmogorov e
+ * a da extração do corte, e as máscaras de bits (sementes e resultado).
+ */
+template <typename Capacity>
+constexpr size_t tileBytesPerPixel()
+{
+    return BasicGraph<Capacity>::gridBytesPerPixel()
+           + sizeof(int)     // pixels
+           + 2 * sizeof(int) // setS e setT
+           + 3 * sizeof(int) // filas do Boykov–Kolmogorov e de extractCut
+           + 1;              // máscaras de bits
+}
+
+// Pico de memória residente do processo até agora, em bytes (0 se o sistema não informa)
+size_t peakResidentBytes()
+{
+#if defined(__unix__) || defined(__APPLE__)
+    struct rusage usage;
+    if (getrusage(RUSAGE_SELF, &usage) == 0)
+    {
+#ifdef __APPLE__
+        return static_cast<size_t>(usage.ru_maxrss); // bytes no macOS
+#else
+        return static_cast<size_t>(usage.ru_maxrss) * 1024; // KiB no Linux
+#endif
+    }
+#endif
+    return 0;
+}
+
+/**
+ * Resolve o corte do bloco de uma imagem e grava em labels (1 = objeto) os
+ * rótulos do retângulo interno. Os pixels do bloco fora do retângulo interno
+ * são margem: com pinOutside ficam presos aos rótulos atuais (pinSeeds), o
+ * que torna o corte do bloco exato dado o resto da imagem; sem pinOutside
+ * ficam livres e seu resultado é descartado.
+ *
+ * O grafo e os vetores de workspace são reaproveitados (BasicGraph::reset),
+ * de modo que um bloco do mesmo tamanho ou menor que os anteriores não aloca
+ * de novo a memória do grafo.
+ *
+ * Devolve quantos pixels do retângulo interno mudaram de lado.
+ */
+template <typename Capacity>
+long long solveBlock(ImageView<const uint8_t> image, vector<char> &labels, const TileRect &block, const TileRect &inner,
+                     bool pinOutside, const vector<Capacity> &sourceWeights, const vector<Capacity> &sinkWeights,
+                     const vector<Capacity> &nlinkWeights, TileWorkspace<Capacity> &workspace)
+{
+    int width = image.getWidth();
+    int blockWidth = block.x1 - block.x0;
+    int blockHeight = block.y1 - block.y0;
+
+    vector<int> &pixels = workspace.pixels;
+    pixels.resize(block.pixels());
+    for (int y = 0; y < blockHeight; ++y)
+    {
+        const uint8_t *row = image.row(block.y0 + y) + block.x0;
+        copy(row, row + blockWidth, pixels.begin() + y * blockWidth);
+    }
+
+    int source = block.pixels();
+    int sink = source + 1;
+    BasicGraph<Capacity> &graph = workspace.graph;
+    graph.reset(source + 2, source, sink);
+    graph.buildGrid(pixels, blockWidth, blockHeight, sourceWeights, sinkWeights, nlinkWeights);
+
+    if (pinOutside)
+    {
+        vector<bool> objectSeeds(block.pixels(), false), backgroundSeeds(block.pixels(), false);
+        for (int y = block.y0; y < block.y1; ++y)
+        {
+            for (int x = block.x0; x < block.x1; ++x)
+            {
+                if (!inner.contains(x, y))
+                {
+                    int pixel = (y - block.y0) * blockWidth + (x - block.x0);
+                    (labels[static_cast<size_t>(y) * width + x] ? objectSeeds : backgroundSeeds)[pixel] = true;
+                }
+            }
+        }
+        graph.pinSeeds(objectSeeds, backgroundSeeds);
+    }
+
+    vector<int> &setS = workspace.setS, &setT = workspace.setT;
+    setS.clear();
+    setT.clear();
+    graph.fordFulkerson(setS, setT);
+    vector<bool> segmentationMask = createSegmentationMask(blockWidth, blockHeight, setS, setT);
+
+    long long changed = 0;
+    for (int y = inner.y0; y < inner.y1; ++y)
+    {
+        for (int x = inner.x0; x < inner.x1; ++x)
+        {
+            char label = segmentationMask[(y - block.y0) * blockWidth + (x - block.x0)];
+            char &current = labels[static_cast<size_t>(y) * width + x];
+            changed += current != label;
+            current = label;
+        }
+    }
+    return changed;
+}
+
+/**
+ * Segmentação em tiles para imagens cujo grafo não cabe na memória.
+ *
+ * 1. Os histogramas (mesma divisão pela média de computeHistograms) e as
+ *    tabelas de pesos são calculados uma vez para a imagem inteira, de modo
+ *    que todas as tiles resolvem a mesma energia.
+ * 2. A imagem é dividida em tiles quadradas; cada uma é resolvida com uma
+ *    margem de options.overlap pixels em volta, descartada no final, para que
+ *    a borda artificial do bloco não alcance o núcleo. Até options.threads
+ *    tiles ficam residentes ao mesmo tempo, e o lado da tile é o maior cujo
+ *    bloco (tileBytesPerPixel) cabe na sua parte do orçamento. Cada thread
+ *    reaproveita o mesmo grafo e resolve primeiro os blocos maiores, então
+ *    a memória dos grafos não passa da de um bloco por thread.
+ * 3. As costuras entre tiles são re-resolvidas em faixas estreitas (largura
+ *    2 * overlap), com a borda de cada faixa presa aos rótulos vizinhos. Cada
+ *    faixa é um passo exato de descida por blocos, então a energia global
+ *    nunca aumenta; as passadas param quando nenhum pixel muda de lado ou
+ *    depois de options.seamPasses.
+ *
+ * Com uma única tile o resultado é o mesmo de buildSegmentationGraph na
+ * imagem inteira. O orçamento cobre os blocos: a imagem (1 byte por pixel)
+ * e os rótulos (1 byte por pixel) ficam inteiros na memória, fora dele.
+ *
+ * @error Se o orçamento não comporta uma tile maior que as suas margens, é
+ *        lançado invalid_argument
+ */
+template <typename Capacity>
+vector<bool> segmentTiled(ImageView<const uint8_t> image, double sigma, double lambda,
+                          const TiledCutOptions &options = TiledCutOptions(), TiledCutStats *stats = nullptr)
+{
+    int width = image.getWidth();
+    int height = image.getHeight();
+    int overlap = max(1, options.overlap);
+    int threads = max(1, options.threads);
+    const size_t bytesPerPixel = tileBytesPerPixel<Capacity>();
+
+    int side = static_cast<int>(sqrt(static_cast<double>(options.memoryBudget / threads / bytesPerPixel)));
+    int tileSize = side - 2 * overlap;
+    if (tileSize < 2 * overlap + 2)
+    {
+        throw invalid_argument("segmentTiled: orçamento de memória pequeno demais para a sobreposição");
+    }
+    tileSize = min(tileSize, max(width, height));
+    int tilesX = (width + tileSize - 1) / tileSize;
+    int tilesY = (height + tileSize - 1) / tileSize;
+    int tileCount = tilesX * tilesY;
+
+    // Histogramas da imagem inteira, linha a linha
+    vector<long long> counts(256, 0);
+    long long sum = 0;
+    for (int y = 0; y < height; ++y)
+    {
+        const uint8_t *row = image.row(y);
+        for (int x = 0; x < width; ++x)
+        {
+            counts[row[x]]++;
+            sum += row[x];
+        }
+    }
+    long long threshold = sum / (static_cast<long long>(width) * height);
+    vector<int> objectHistogram(256, 0), backgroundHistogram(256, 0);
+    for (int intensity = 0; intensity < 256; ++intensity)
+    {
+        int count = static_cast<int>(min<long long>(counts[intensity], INT_MAX));
+        (intensity <= threshold ? backgroundHistogram : objectHistogram)[intensity] = count;
+    }
+
+    vector<Capacity> sourceWeights, sinkWeights;
+    BasicGraph<Capacity>::tlinkTables(objectHistogram, backgroundHistogram, sourceWeights, sinkWeights);
+    vector<Capacity> nlinkWeights = BasicGraph<Capacity>::nlinkTable(sigma, lambda);
+
+    auto clip = [&](int x0, int y0, int x1, int y1)
+    {
+        return TileRect{max(0, x0), max(0, y0), min(width, x1), min(height, y1)};
+    };
+    auto tileCore = [&](int tile)
+    {
+        int x0 = (tile % tilesX) * tileSize;
+        int y0 = (tile / tilesX) * tileSize;
+        return clip(x0, y0, x0 + tileSize, y0 + tileSize);
+    };
+
+    auto tileBlock = [&](int tile)
+    {
+        TileRect core = tileCore(tile);
+        return clip(core.x0 - overlap, core.y0 - overlap, core.x1 + overlap, core.y1 + overlap);
+    };
+
+    // Blocos maiores primeiro: os seguintes cabem na memória já alocada pelo grafo de cada thread
+    vector<int> order(tileCount);
+    for (int tile = 0; tile < tileCount; ++tile)
+    {
+        order[tile] = tile;
+    }
+    stable_sort(order.begin(), order.end(), [&](int a, int b)
+    {
+        return tileBlock(a).pixels() > tileBlock(b).pixels();
+    });
+
+    // Tiles com margem; os núcleos são disjuntos, então as threads gravam em partes distintas de labels
+    vector<char> labels(static_cast<size_t>(width) * height, 0);
+    vector<TileWorkspace<Capacity>> workspaces(min(threads, tileCount));
+    atomic<int> nextTile(0);
+    vector<thread> workers;
+    for (size_t t = 0; t < workspaces.size(); ++t)
+    {
+        workers.emplace_back([&, t]()
+        {
+            for (int next = nextTile++; next < tileCount; next = nextTile++)
+            {
+                int tile = order[next];
+                solveBlock(image, labels, tileBlock(tile), tileCore(tile), false, sourceWeights, sinkWeights, nlinkWeights,
+                           workspaces[t]);
+            }
+        });
+    }
+    for (thread &worker : workers)
+    {
+        worker.join();
+    }
+    workspaces.resize(1); // as faixas das costuras são resolvidas uma de cada vez
+
+    if (stats)
+    {
+        stats->tileSize = tileSize;
+        stats->tilesX = tilesX;
+        stats->tilesY = tilesY;
+        stats->seamChanges.clear();
+    }
+
+    // Faixas ao longo das costuras verticais e depois das horizontais, uma de cada vez
+    for (int pass = 0; pass < options.seamPasses && tileCount > 1; ++pass)
+    {
+        long long changed = 0;
+        for (int tile = 0; tile < tileCount; ++tile)
+        {
+            TileRect core = tileCore(tile);
+            if (core.x0 > 0)
+            {
+                TileRect band = clip(core.x0 - overlap, core.y0 - overlap, core.x0 + overlap, core.y1 + overlap);
+                TileRect block = clip(band.x0 - 1, band.y0 - 1, band.x1 + 1, band.y1 + 1);
+                changed += solveBlock(image, labels, block, band, true, sourceWeights, sinkWeights, nlinkWeights, workspaces[0]);
+            }
+        }
+        for (int tile = 0; tile < tileCount; ++tile)
+        {
+            TileRect core = tileCore(tile);
+            if (core.y0 > 0)
+            {
+                TileRect band = clip(core.x0 - overlap, core.y0 - overlap, core.x1 + overlap, core.y0 + overlap);
+                TileRect block = clip(band.x0 - 1, band.y0 - 1, band.x1 + 1, band.y1 + 1);
+                changed += solveBlock(image, labels, block, band, true, sourceWeights, sinkWeights, nlinkWeights, workspaces[0]);
+            }
+        }
+
+        if (stats)
+        {
+            stats->seamChanges.push_back(changed);
+        }
+        if (changed == 0)
+        {
+            break;
+        }
+    }
+
+    vector<bool> segmentationMask(labels.size());
+    for (size_t pixel = 0; pixel < labels.size(); ++pixel)
+    {
+        segmentationMask[pixel] = labels[pixel];
+    }
+    return segmentationMask;
+}
+
+/**
+ * Segmenta uma imagem PGM em tiles com o orçamento de memória dado (em MiB)
+ * e grava a máscara em tiled_output.pgm (255 = objeto, 0 = fundo).
+ */
+template <typename Capacity>
+void segmentTiledImage(const string &filename, size_t budgetMiB, int threads, double sigma, double lambda)
+{
+    Image<uint8_t> image;
+    try
+    {
+        image = loadPGM<uint8_t>(filename);
+    }
+    catch (const runtime_error &e)
+    {
+        cerr << filename << ": " << e.what() << endl;
+        return;
+    }
+
+    TiledCutOptions options;
+    options.memoryBudget = budgetMiB << 20;
+    options.threads = threads;
+    TiledCutStats stats;
+
+    auto start = chrono::steady_clock::now();
+    vector<bool> segmentationMask;
+    try
+    {
+        segmentationMask = segmentTiled<Capacity>(image.view(), sigma, lambda, options, &stats);
+    }
+    catch (const invalid_argument &e)
+    {
+        cerr << e.what() << endl;
+        return;
+    }
+    double seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+
+    cout << filename << " (" << image.getWidth() << "x" << image.getHeight() << "): " << stats.tilesX << "x" << stats.tilesY
+         << " tiles de " << stats.tileSize << " pixels, " << seconds << " s, pico de memória do processo "
+         << peakResidentBytes() / 1048576.0 << " MiB (orçamento dos blocos " << budgetMiB << " MiB)" << endl;
+    for (size_t pass = 0; pass < stats.seamChanges.size(); ++pass)
+    {
+        cout << "  costuras, passada " << pass + 1 << ": " << stats.seamChanges[pass] << " pixels mudaram" << endl;
+    }
+
+    Image<uint8_t> output(image.getWidth(), image.getHeight());
+    for (int y = 0; y < image.getHeight(); ++y)
+    {
+        uint8_t *row = output.row(y);
+        for (int x = 0; x < image.getWidth(); ++x)
+        {
+            row[x] = segmentationMask[static_cast<size_t>(y) * image.getWidth() + x] ? 255 : 0;
+        }
+    }
+    savePGM<uint8_t>("tiled_output.pgm", output.view());
+}
+
+// Executa o modo escolhido com capacidades do tipo Capacity
+template <typename Capacity>
+void run(const vector<string> &arguments, double sigma, double lambda)
+{
+    if (!arguments.empty() && arguments[0] == "--benchmark")
+    {
+        benchmarkEngines<Capacity>(vector<string>(arguments.begin() + 1, arguments.end()), sigma, lambda);
+        return;
+    }
+    if (!arguments.empty() && arguments[0] == "--dynamic")
+    {
+        benchmarkDynamicCut<Capacity>(vector<string>(arguments.begin() + 1, arguments.end()), sigma, lambda);
+        return;
+    }
+    if (arguments.size() >= 3 && arguments[0] == "--seeds")
+    {
+        segmentSeededImage<Capacity>(arguments[1], arguments[2], arguments.size() >= 4 ? arguments[3] : "teste.pgm", sigma, lambda);
+        return;
+    }
+    if (arguments.size() >= 3 && arguments[0] == "--tiled")
+    {
+        int threads = arguments.size() >= 4 ? atoi(arguments[3].c_str()) : 1;
+        segmentTiledImage<Capacity>(arguments[2], strtoull(arguments[1].c_str(), nullptr, 10), threads, sigma, lambda);
+        return;
+    }
+    segmentTestImage<Capacity>(sigma, lambda);
+}
+
+int main(int argc, char **argv)
+{
+    double sigma = 100.0;
+    double lambda = 20.0;
+
+    // --capacity int|fixed|float escolhe o tipo das capacidades (padrão: int, pesos truncados)
+    vector<string> arguments(argv + 1, argv + argc);
+    string capacity = "int";
+    if (arguments.size() >= 2 && arguments[0] == "--capacity")
+    {
+        capacity = arguments[1];
+        arguments.erase(arguments.begin(), arguments.begin() + 2);
+    }
+
+    if (capacity == "int")
+    {
+        run<int>(arguments, sigma, lambda);
+    }
+    else if (capacity == "fixed")
+    {
+        run<int64_t>(arguments, sigma, lambda);
+    }
+    else if (capacity == "float")
+    {
+        run<float>(arguments, sigma, lambda);
+    }
+    else
+    {
+        cerr << "Tipo de capacidade desconhecido: " << capacity << " (use int, fixed ou float)" << endl;
+        return 1;
+    }
 
     return 0;
-}
\ No newline at end of file
+}
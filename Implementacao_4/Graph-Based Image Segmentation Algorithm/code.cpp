@@ -2,43 +2,442 @@
 #include <vector>
 #include <cmath>
 #include <algorithm>
-#include "./lib/pgmToMatrix.hpp"
-#include "./lib/PythonScripts.hpp"
+#include "./lib/PgmToMatrix.hpp"
 #include "./lib/DisjointSet.hpp"
 #include "./lib/MatrixToPgm.hpp"
 #include "./lib/edges.hpp"
+#include "./lib/ParallelSegmentation.hpp"
+#include "./lib/ConcurrentDisjointSet.hpp"
+#include "./lib/BatchSegmentation.hpp"
+#include "./lib/ParameterSweep.hpp"
+#include "./lib/MergeTree.hpp"
+#include <chrono>
+#include <cstring>
+#include <filesystem>
+#include <random>
+#include <string>
+#include <thread>
 
 
-int main() {
+// Grid graph of createEdgeList over a random image with few intensity levels,
+// so that the edges of weight 0 form components of every size
+vector<Edge> _randomGridEdges(int width, int height, int levels, unsigned seed) {
+    Image<Pixel> image(width, height);
+    mt19937 random(seed);
+    for (int y = 0; y < height; ++y) {
+        for (int x = 0; x < width; ++x) {
+            image.at(y, x) = random() % levels;
+        }
+    }
+    return createEdgeList(image);
+}
+
+
+/*
+ * Teste de estresse da ConcurrentDisjointSet: 16 threads unem e consultam a mesma
+ * estrutura ao mesmo tempo, em ordens diferentes. O resultado deve ser a mesma
+ * partição da DisjointSet sequencial, e cada par unido por uma thread deve ser
+ * visto no mesmo conjunto por ela logo em seguida.
+ */
+bool stressConcurrentDisjointSet(int rounds) {
+    const int width = 512, height = 512, threads = 16;
+    int n = width * height;
+
+    for (int round = 0; round < rounds; ++round) {
+        vector<Edge> edges = _randomGridEdges(width, height, 2 + round % 3, round);
+        shuffle(edges.begin(), edges.end(), mt19937(round));
+
+        DisjointSet sequential(n);
+        for (const Edge& e : edges) {
+            if (e.weight == 0) sequential.unionSets(e.v1, e.v2);
+        }
+
+        ConcurrentDisjointSet concurrent(n);
+        atomic<bool> failed(false);
+        vector<thread> workers;
+        for (int t = 0; t < threads; ++t) {
+            workers.emplace_back([&, t]() {
+                // Interleaved blocks: every thread walks the whole list, from a different start
+                for (size_t j = 0; j < edges.size(); ++j) {
+                    const Edge& e = edges[(j + edges.size() * t / threads) % edges.size()];
+                    if (e.weight != 0) {
+                        concurrent.isSameSet(e.v1, e.v2);
+                        continue;
+                    }
+                    concurrent.unionSets(e.v1, e.v2);
+                    if (!concurrent.isSameSet(e.v1, e.v2)) failed = true;
+                }
+            });
+        }
+        for (thread& worker : workers) worker.join();
+
+        Image<Label> expected = sequential.toImage(width, height);
+        Image<Label> obtained = concurrent.toImage(width, height);
+        if (failed || concurrent.getQuantity() != sequential.getQuantity()
+            || countDifferingComponents(expected, obtained) != 0) {
+            std::cout << "Rodada " << round << ": FALHOU (" << concurrent.getQuantity()
+                      << " conjuntos, esperado " << sequential.getQuantity() << ")" << endl;
+            return false;
+        }
+    }
+    std::cout << "Teste de estresse: " << rounds << " rodadas com " << threads << " threads, OK" << endl;
+    return true;
+}
+
+
+// Vazão da rotulação de componentes conexos em paralelo com 1, 2, 4, 8 e 16 threads
+void benchmarkConcurrentDisjointSet(int width, int height) {
+    int n = width * height;
+    vector<Edge> edges = _randomGridEdges(width, height, 3, 1);
+    std::cout << "Grade " << width << "x" << height << ", " << edges.size() << " arestas" << endl;
+
+    Image<Label> reference;
+    double referenceSeconds = 0.0;
+    for (int threads : {1, 2, 4, 8, 16}) {
+        auto start = chrono::steady_clock::now();
+        ConcurrentDisjointSet ds = connectedComponents(n, edges, 0, threads);
+        double seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+
+        Image<Label> labels = ds.toImage(width, height);
+        bool same = true;
+        if (threads == 1) {
+            reference = move(labels);
+            referenceSeconds = seconds;
+        } else {
+            same = countDifferingComponents(reference, labels) == 0;
+        }
+        std::cout << "  " << threads << " threads: " << seconds * 1000 << " ms, "
+                  << edges.size() / seconds / 1e6 << " M arestas/s, speedup " << referenceSeconds / seconds << "x, "
+                  << ds.getQuantity() << " componentes" << (same ? "" : " (RESULTADO DIFERENTE!)") << endl;
+    }
+}
+
+
+// Pergunta qual das imagens da pasta será segmentada
+string chooseImage(const string& directory) {
+    vector<string> images = listImages(directory);
+    if (images.empty()) {
+        throw runtime_error("Nenhuma imagem PNG em " + directory);
+    }
+    std::cout << "Choose an image to convert:" << endl;
+    for (size_t i = 0; i < images.size(); ++i) {
+        std::cout << i + 1 << ". " << filesystem::path(images[i]).filename().string() << endl;
+    }
+    std::cout << "Enter the number of the image: ";
+    size_t choice = 0;
+    if (!(cin >> choice) || choice < 1 || choice > images.size()) {
+        throw runtime_error("Escolha inválida.");
+    }
+    return images[choice - 1];
+}
+
+
+// Lista de valores de k separados por vírgula, p.ex. "150,300,600"
+vector<int> parseThresholds(const string& text) {
+    vector<int> ks;
+    size_t first = 0;
+    while (first <= text.size()) {
+        size_t last = min(text.find(',', first), text.size());
+        int k = stoi(text.substr(first, last - first));
+        if (k <= 0) {
+            throw runtime_error("Valor de k inválido: " + to_string(k));
+        }
+        ks.push_back(k);
+        first = last + 1;
+    }
+    return ks;
+}
+
+
+// Segmenta a imagem com cada valor de k e grava output/converted-k<k>.png
+void runSweep(ImageView<const Pixel> image, const vector<int>& ks, int threads, int minSize, PnmWriteMode mode) {
+    auto start = chrono::steady_clock::now();
+    vector<SweepResult> results = sweepThresholds(image, ks, threads, 3, 0.8f, minSize);
+    double seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+
+    filesystem::create_directories("./output");
+    for (const SweepResult& result : results) {
+        string output = "./output/converted-k" + to_string(result.k) + ".png";
+        std::cout << "k = " << result.k << ": " << result.components.stats.size() << " conjuntos -> " << output << endl;
+        colorpgm::MatrixToPGM(result.components.stats.size(), result.components.labels, output, mode);
+    }
+    std::cout << ks.size() << " valores de k em " << seconds * 1000 << " ms (" << threads << " threads)" << endl;
+}
+
+
+/*
+ * Extrai da árvore de fusões a segmentação de cada k e grava output/converted-k<k>.png.
+ * Com edges, também informa quantos componentes diferem da segmentação direta do mesmo k.
+ */
+void extractFromTree(const MergeTree& tree, ImageView<const Pixel> image, const vector<int>& ks,
+                     const BucketedEdges* edges, PnmWriteMode mode) {
+    int width = image.getWidth(), height = image.getHeight();
+    filesystem::create_directories("./output");
+    for (int k : ks) {
+        auto start = chrono::steady_clock::now();
+        Components components = tree.labelsFor(image, k);
+        double seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+
+        string output = "./output/converted-k" + to_string(k) + ".png";
+        std::cout << "k = " << k << ": " << components.stats.size() << " conjuntos em " << seconds * 1000 << " ms";
+        if (edges) {
+            DisjointSet direct = segmentation(width * height, k, *edges);
+            std::cout << " (segmentação direta: " << direct.getQuantity() << " conjuntos, "
+                      << countDifferingComponents(direct.toImage(width, height), components.labels) << " diferentes)";
+        }
+        std::cout << " -> " << output << endl;
+        colorpgm::MatrixToPGM(components.stats.size(), components.labels, output, mode);
+    }
+}
+
+
+// Constrói a árvore de fusões da imagem, grava-a em treeFile e extrai dela cada k
+void runMergeTree(ImageView<const Pixel> image, const vector<int>& ks, const string& treeFile, PnmWriteMode mode) {
+    Image<Pixel> smoothedImage = applyGaussianFilter(image, 3, 0.8f);
+    BucketedEdges edges = createBucketedEdges(smoothedImage);
+
+    auto start = chrono::steady_clock::now();
+    MergeTree tree = buildMergeTree(image.getWidth(), image.getHeight(), edges);
+    double seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+    tree.save(treeFile, mode);
+    std::cout << "Árvore de fusões: " << tree.getMerges().size() << " fusões em " << seconds * 1000
+              << " ms -> " << treeFile << endl;
+
+    extractFromTree(tree, image, ks, &edges, mode);
+}
+
+
+// Segmenta um lote de imagens e informa a vazão total
+int runBatch(const vector<string>& arguments, const BatchOptions& options) {
+    vector<string> inputs = collectBatchInputs(arguments);
+    std::cout << inputs.size() << " imagens, " << options.threads << " threads" << endl;
+
+    auto start = chrono::steady_clock::now();
+    vector<BatchResult> results = segmentBatch(inputs, options);
+    double seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+
+    int failures = 0;
+    double megapixels = 0.0;
+    for (const BatchResult& result : results) {
+        if (result.error.empty()) {
+            megapixels += result.width * double(result.height) / 1e6;
+        } else {
+            failures++;
+        }
+    }
+    std::cout << "Total: " << results.size() - failures << " imagens em " << seconds << " s, "
+              << (results.size() - failures) / seconds << " imagens/s, " << megapixels / seconds << " MP/s";
+    if (failures > 0) std::cout << ", " << failures << " falhas";
+    std::cout << endl;
+    return failures > 0 ? 1 : 0;
+}
+
+
+/*
+ * Uso: code [opções] [imagem.png | imagem.pgm]
+ *      code --sweep k1,k2,... [--threads N] [imagem]
+ *      code --merge-tree arquivo [--sweep k1,k2,... | --k K] [imagem]
+ *      code --load-tree arquivo [--sweep k1,k2,... | --k K] [imagem]
+ *      code --batch [--threads N] [--output-dir D] [--memory-mb M] pasta | lista.txt | imagem ...
+ * Sem imagem, pergunta qual imagem da pasta ./images será segmentada.
+ *
+ * Opções:
+ *   --threads N   segmenta a imagem em N faixas em paralelo (padrão: 1, sequencial)
+ *   --k K         usa o limiar K em vez do escolhido pelo tamanho da imagem
+ *   --min-size M  une cada componente com menos de M pixels a um vizinho (padrão: 0, desligado)
+ *   --color       segmenta pelas cores (distância euclidiana RGB) em vez dos tons de cinza
+ *   --compare     com --threads, informa quantos componentes diferem da segmentação sequencial
+ *   --mmap-output escreve o resultado através de um arquivo mapeado em memória
+ *   --save-intermediate  também grava output/original.pgm, output/result_gray.png e output/converted.ppm
+ *   --union-find-bench   teste de estresse e vazão da ConcurrentDisjointSet (sem imagem)
+ *
+ * No modo --batch, cada uma das N threads (padrão: todos os núcleos) segmenta uma imagem
+ * por vez e grava <pasta de saída>/<nome>-segmented.png; --memory-mb limita a memória
+ * das imagens em processamento.
+ *
+ * No modo --sweep, a suavização e as arestas são calculadas uma só vez e cada valor de k é
+ * segmentado por uma das N threads (padrão: todos os núcleos), gravando output/converted-k<k>.png.
+ * --k não pode ser combinado com --sweep (também com --merge-tree e --load-tree).
+ *
+ * Com --merge-tree, a árvore de fusões (lib/MergeTree.hpp) é gravada no arquivo e as segmentações
+ * dos valores de k são extraídas dela, informando quantos componentes diferem da segmentação direta.
+ * Com --load-tree, as segmentações são extraídas de uma árvore já gravada, sem segmentar a imagem.
+ */
+int main(int argc, char** argv) {
     try {
-        generatePgmFromFilename(); // Generate a PGM file from a PNG file
+        int threads = 0; // 0: not given
+        int threshold = 0; // 0: chosen from the image size
+        vector<int> sweep;
+        string treeFile;
+        bool loadTree = false;
+        bool color = false;
+        int minSize = 0; // 0: no minimum
+        bool compare = false;
+        bool batch = false;
+        BatchOptions batchOptions;
+        vector<string> batchArguments;
+        bool saveIntermediate = false;
+        string filename;
+        PnmWriteMode outputMode = PnmWriteMode::Buffered;
+        for (int i = 1; i < argc; ++i) {
+            if (strcmp(argv[i], "--threads") == 0 && i + 1 < argc) {
+                threads = stoi(argv[++i]);
+                if (threads <= 0) threads = max(1u, std::thread::hardware_concurrency());
+            } else if (strcmp(argv[i], "--k") == 0 && i + 1 < argc) {
+                threshold = stoi(argv[++i]);
+                if (threshold <= 0) throw runtime_error("Valor de k inválido: " + to_string(threshold));
+            } else if (strcmp(argv[i], "--sweep") == 0 && i + 1 < argc) {
+                sweep = parseThresholds(argv[++i]);
+            } else if ((strcmp(argv[i], "--merge-tree") == 0 || strcmp(argv[i], "--load-tree") == 0) && i + 1 < argc) {
+                loadTree = strcmp(argv[i], "--load-tree") == 0;
+                treeFile = argv[++i];
+            } else if (strcmp(argv[i], "--min-size") == 0 && i + 1 < argc) {
+                minSize = max(0, stoi(argv[++i]));
+            } else if (strcmp(argv[i], "--color") == 0) {
+                color = true;
+            } else if (strcmp(argv[i], "--compare") == 0) {
+                compare = true;
+            } else if (strcmp(argv[i], "--mmap-output") == 0) {
+                outputMode = PnmWriteMode::Mapped;
+            } else if (strcmp(argv[i], "--save-intermediate") == 0) {
+                saveIntermediate = true;
+            } else if (strcmp(argv[i], "--batch") == 0) {
+                batch = true;
+            } else if (strcmp(argv[i], "--output-dir") == 0 && i + 1 < argc) {
+                batchOptions.outputDirectory = argv[++i];
+            } else if (strcmp(argv[i], "--memory-mb") == 0 && i + 1 < argc) {
+                long long megabytes = stoll(argv[++i]);
+                if (megabytes <= 0) throw runtime_error("Valor de --memory-mb inválido: " + to_string(megabytes));
+                batchOptions.memoryBudget = static_cast<size_t>(megabytes) << 20;
+            } else if (argv[i][0] != '-') {
+                batchArguments.push_back(argv[i]);
+            } else if (strcmp(argv[i], "--union-find-bench") == 0) {
+                if (!stressConcurrentDisjointSet(20)) return 1;
+                benchmarkConcurrentDisjointSet(4096, 4096);
+                return 0;
+            } else {
+                std::cerr << "Uso: " << argv[0] << " [--threads N] [--k K] [--min-size M] [--color] [--compare] [--mmap-output] [--save-intermediate] [imagem] | --union-find-bench" << endl;
+                std::cerr << "     " << argv[0] << " --sweep k1,k2,... [--threads N] [imagem]" << endl;
+                std::cerr << "     " << argv[0] << " --merge-tree | --load-tree arquivo [--sweep k1,k2,... | --k K] [imagem]" << endl;
+                std::cerr << "     " << argv[0] << " --batch [--threads N] [--output-dir D] [--memory-mb M] pasta | lista.txt | imagem ..." << endl;
+                return 1;
+            }
+        }
 
-        vector<vector<int>> matrix = readPGM("./output/original.pgm"); // Read the PGM file and return a matrix of pixels
-        vector<vector<int>> smoothedMatrix = applyGaussianFilter(matrix, 3, 0.8f);
+        if (!sweep.empty() && threshold > 0) {
+            throw runtime_error("--k e --sweep não podem ser usados juntos; inclua o valor de k na lista do --sweep");
+        }
+        if (batch) {
+            batchOptions.threads = threads > 0 ? threads : max(1u, std::thread::hardware_concurrency());
+            batchOptions.mode = outputMode;
+            batchOptions.minSize = minSize;
+            return runBatch(batchArguments, batchOptions);
+        }
+        if (batchArguments.size() > 1) {
+            std::cerr << "Apenas uma imagem por vez; use --batch para várias." << endl;
+            return 1;
+        }
+        if (!batchArguments.empty()) {
+            filename = batchArguments[0];
+        }
+        if (filename.empty()) {
+            filename = chooseImage("./images");
+        }
 
-        // cout << "Proporcao da imagem: "<< smoothedMatrix[0].size() << " x " << matrix.size() << endl;
-        // cout << matrix << endl;
+        if (!treeFile.empty()) {
+            Image<Pixel> image = readImage(filename);
+            if (sweep.empty()) {
+                sweep.push_back(threshold > 0 ? threshold : defaultThreshold(image.getWidth(), image.getHeight()));
+            }
+            if (loadTree) {
+                extractFromTree(MergeTree::load(treeFile), image, sweep, nullptr, outputMode);
+            } else {
+                runMergeTree(image, sweep, treeFile, outputMode);
+            }
+            return 0;
+        }
+        if (!sweep.empty()) {
+            threads = threads > 0 ? threads : max(1u, std::thread::hardware_concurrency());
+            runSweep(readImage(filename), sweep, threads, minSize, outputMode);
+            return 0;
+        }
+        threads = max(threads, 1);
 
-        auto res = createEdgeList(smoothedMatrix);
-        vector<Edge> edges = res;
-        sort(edges.begin(), edges.end(), compareEdges);
-        
-        // std::cout << matrixEdgeListToString(edges, matrix[0].size()) << endl;
-        // std::cout << matrixGraphToString(res.first, matrix[0].size()) << endl;
+        PlanarImage<Pixel> colorImage;
+        Image<Pixel> image;
+        if (color) {
+            colorImage = readColorImage(filename); // One plane per channel
+            image = colorToGrey(colorImage);       // Only for the intermediate files and the component stats
+            if (threads > 1) {
+                std::cerr << "A segmentação colorida é sequencial; --threads ignorado." << endl;
+                threads = 1;
+            }
+        } else {
+            image = readImage(filename); // Decode the PNG (or PGM) into a single contiguous grey image
+        }
+        if (saveIntermediate) {
+            filesystem::create_directories("./output");
+            savePGM<Pixel>("./output/original.pgm", image, outputMode);
+            savePNG("./output/result_gray.png", image, outputMode);
+        }
+        Image<Pixel> smoothedImage = color ? Image<Pixel>() : applyGaussianFilter(image, 3, 0.8f);
+        PlanarImage<Pixel> smoothedColor = color ? applyGaussianFilter(colorImage, 3, 0.8f) : PlanarImage<Pixel>();
+
+        // cout << "Proporcao da imagem: "<< image.getWidth() << " x " << image.getHeight() << endl;
+        // cout << image.view() << endl;
 
-        int halfPerimeter = (matrix.size() + matrix[0].size());
-        int threshold = halfPerimeter <= 260 ? 150 : halfPerimeter <= 560 ? 300 : 600;
-        // int threshold = 250
+        if (threshold == 0) {
+            threshold = defaultThreshold(image.getWidth(), image.getHeight());
+        }
 
-        DisjointSet ds = segmentation(matrix.size()*matrix[0].size(), threshold, edges); // Segment the image (number of vertices, threshold, edges)
+        auto start = chrono::steady_clock::now();
+        DisjointSet ds(0);
+        if (color) {
+            BucketedEdges edges = createColorBucketedEdges(smoothedColor); // Rounded RGB distances, 0..442
+            ds = segmentation(image.getHeight()*image.getWidth(), threshold, edges);
+            mergeSmallComponents(ds, minSize, edges);
+        } else if (threads > 1) {
+            ds = parallelSegmentation(smoothedImage, threshold, threads); // Segment horizontal strips in parallel
+            if (minSize > 1) {
+                mergeSmallComponents(ds, minSize, createBucketedEdges(smoothedImage)); // Needs the edges of the whole image
+            }
+        } else {
+            BucketedEdges edges = createBucketedEdges(smoothedImage); // Edges already grouped by weight, no sort needed
+            ds = segmentation(image.getHeight()*image.getWidth(), threshold, edges); // Segment the image (number of vertices, threshold, edges)
+            mergeSmallComponents(ds, minSize, edges); // Join the components below the minimum size, if any
+        }
+        double seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
         
-        // ds.printConjuncts(matrix[0].size(), matrix.size());
+        // ds.printConjuncts(image.getWidth(), image.getHeight());
 
         std::cout << "Quantidade de conjuntos resultantes: " << ds.getQuantity() << endl;
 
-        colorpgm::MatrixToPGM(ds.getQuantity(), ds.toMatrix(matrix.size(), matrix[0].size()), "./output/converted.pgm");
+        Components components = ds.finalize(image); // Dense labels 0..k-1 and per-component stats
+
+        if (threads > 1) {
+            std::cout << "Segmentação com " << threads << " threads: " << seconds * 1000 << " ms" << endl;
+        }
+        if (threads > 1 && compare) {
+            auto sequentialStart = chrono::steady_clock::now();
+            BucketedEdges edges = createBucketedEdges(smoothedImage);
+            DisjointSet sequential = segmentation(image.getHeight()*image.getWidth(), threshold, edges);
+            mergeSmallComponents(sequential, minSize, edges);
+            double sequentialSeconds = chrono::duration<double>(chrono::steady_clock::now() - sequentialStart).count();
+            Image<Label> sequentialLabels = sequential.toImage(image.getWidth(), image.getHeight());
+
+            std::cout << "Segmentação sequencial: " << sequentialSeconds * 1000 << " ms ("
+                      << sequential.getQuantity() << " conjuntos)" << endl;
+            std::cout << "Componentes diferentes da segmentação sequencial: "
+                      << countDifferingComponents(sequentialLabels, components.labels) << " de " << sequential.getQuantity() << endl;
+        }
+        filesystem::create_directories("./output");
+        colorpgm::MatrixToPGM(components.stats.size(), components.labels, "./output/converted.png", outputMode);
+        if (saveIntermediate) {
+            colorpgm::MatrixToPGM(components.stats.size(), components.labels, "./output/converted.ppm", outputMode);
+        }
         
     } catch (const std::exception& e) {
         std::cerr << "Erro: " << e.what() << std::endl;
+        return 1;
     }
 } 
\ No newline at end of file
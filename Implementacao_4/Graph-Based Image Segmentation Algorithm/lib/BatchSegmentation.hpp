@@ -0,0 +1,243 @@
+#ifndef BATCHSEGMENTATION_HPP // Check if BATCHSEGMENTATION_HPP is not defined
+#define BATCHSEGMENTATION_HPP // Define BATCHSEGMENTATION_HPP
+
+
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include "./PgmToMatrix.hpp"
+#include "./DisjointSet.hpp"
+#include "./MatrixToPgm.hpp"
+#include "./WorkerPool.hpp"
+#include "./edges.hpp"
+
+
+using namespace std;
+
+
+// Peak bytes per pixel of one image going through segmentImageFile: grey and smoothed
+// images (2), weight buckets (4 edges * 5 bytes), DisjointSet (8), dense labels (4),
+// colored result (3), PNG filtering and compression (about 4), plus the decode buffers
+static const size_t BATCH_BYTES_PER_PIXEL = 48;
+
+
+/**
+ * Default k of the segmentation, chosen by the half perimeter of the image
+ *
+ * @param width Image width
+ * @param height Image height
+ * @return 150, 300 or 600
+ */
+int defaultThreshold(int width, int height) {
+    int halfPerimeter = height + width;
+    return halfPerimeter <= 260 ? 150 : halfPerimeter <= 560 ? 300 : 600;
+}
+
+
+/**
+ * Segments one image file and writes the colored result
+ *
+ * Same chain as the interactive program: read, Gaussian filter, weight buckets,
+ * segmentation with the default k, minimum size pass, dense labels and colored output.
+ *
+ * @param input PNG or PGM file to segment
+ * @param output File to write (".png", or binary ppm otherwise)
+ * @param mode Buffered or memory-mapped output
+ * @param minSize Components smaller than this are merged into a neighbour (see mergeSmallComponents)
+ * @return Number of components found
+ *
+ * @error If the input could not be read or the output could not be written, a runtime_error is thrown
+ */
+int segmentImageFile(const string& input, const string& output, PnmWriteMode mode = PnmWriteMode::Buffered, int minSize = 0) {
+    Image<Pixel> image = readImage(input);
+    Image<Pixel> smoothedImage = applyGaussianFilter(image, 3, 0.8f);
+
+    DisjointSet ds(0);
+    {
+        BucketedEdges edges = createBucketedEdges(smoothedImage);
+        ds = segmentation(image.getWidth() * image.getHeight(), defaultThreshold(image.getWidth(), image.getHeight()), edges);
+        mergeSmallComponents(ds, minSize, edges);
+    }
+    smoothedImage = Image<Pixel>();
+
+    Components components = ds.finalize(image);
+    ds = DisjointSet(0);
+    colorpgm::MatrixToPGM(components.stats.size(), components.labels, output, mode);
+    return static_cast<int>(components.stats.size());
+}
+
+
+/**
+ * @class BatchOptions
+ * @brief Settings of segmentBatch
+ */
+struct BatchOptions {
+    int threads = 1;                   // Workers, each segmenting one image at a time
+    size_t memoryBudget = 0;           // Bytes of images in flight (BATCH_BYTES_PER_PIXEL each pixel); 0 = no limit
+    string outputDirectory = "./output";
+    PnmWriteMode mode = PnmWriteMode::Buffered;
+    int minSize = 0;                   // Minimum component size, 0 = no minimum
+    bool verbose = true;               // Print one line per image
+};
+
+
+/**
+ * @class BatchResult
+ * @brief Outcome of one image of a batch
+ */
+struct BatchResult {
+    string input;
+    string output;
+    int width = 0, height = 0;
+    int components = 0;
+    double seconds = 0.0;
+    string error;                      // Empty when the image was segmented
+};
+
+
+/**
+ * @class _MemoryBudget
+ * @brief Counting semaphore over bytes, bounding the images processed at once
+ *
+ * An image larger than the whole budget is still processed, but alone.
+ */
+class _MemoryBudget {
+ private:
+    size_t capacity;
+    size_t used = 0;
+    mutex lock;
+    condition_variable released;
+
+ public:
+    explicit _MemoryBudget(size_t capacity) : capacity(capacity) {}
+
+    void acquire(size_t bytes) {
+        if (capacity == 0) return;
+        unique_lock<mutex> guard(lock);
+        released.wait(guard, [&]() { return used == 0 || used + bytes <= capacity; });
+        used += bytes;
+    }
+
+    void release(size_t bytes) {
+        if (capacity == 0) return;
+        {
+            lock_guard<mutex> guard(lock);
+            used -= bytes;
+        }
+        released.notify_all();
+    }
+};
+
+
+/**
+ * Expands a list of directories, image lists (.txt, one path per line) and image files
+ *
+ * @param arguments Paths given by the user
+ * @return Image files, directories expanded in alphabetical order
+ *
+ * @error If a path does not exist, a runtime_error is thrown
+ */
+vector<string> collectBatchInputs(const vector<string>& arguments) {
+    vector<string> inputs;
+    for (const string& argument : arguments) {
+        if (filesystem::is_directory(argument)) {
+            vector<string> images = listImages(argument);
+            inputs.insert(inputs.end(), images.begin(), images.end());
+        } else if (hasExtension(argument, ".txt")) {
+            ifstream list(argument);
+            if (!list) {
+                throw runtime_error("Não foi possível abrir a lista " + argument);
+            }
+            string line;
+            while (getline(list, line)) {
+                if (!line.empty() && line.back() == '\r') line.pop_back();
+                if (!line.empty()) inputs.push_back(line);
+            }
+        } else if (filesystem::exists(argument)) {
+            inputs.push_back(argument);
+        } else {
+            throw runtime_error("Arquivo não encontrado: " + argument);
+        }
+    }
+    return inputs;
+}
+
+
+/**
+ * @brief Segments many images with a fixed pool of worker threads
+ *
+ * Workers take the next image from a shared counter and run segmentImageFile on it;
+ * image i is written to outputDirectory/<name>-segmented.png (with the position of the
+ * image in front of the name when two inputs share a name). Before decoding an image
+ * its size is read from the header and BATCH_BYTES_PER_PIXEL bytes per pixel are
+ * reserved from the memory budget, so at most that much image data is in flight.
+ *
+ * A failure on one image is recorded in its result and does not stop the batch.
+ * Any other exception in a worker (e.g. bad_alloc while printing) is rethrown once
+ * all the threads have stopped (see parallelFor).
+ *
+ * @param inputs Image files
+ * @param options Threads, memory budget and output settings
+ * @return One result per input, in the same order
+ */
+vector<BatchResult> segmentBatch(const vector<string>& inputs, const BatchOptions& options) {
+    vector<BatchResult> results(inputs.size());
+    filesystem::create_directories(options.outputDirectory);
+
+    // Output names, made unique when different folders hold images with the same name
+    vector<string> names(inputs.size());
+    for (size_t i = 0; i < inputs.size(); ++i) {
+        names[i] = filesystem::path(inputs[i]).stem().string();
+    }
+    vector<string> sorted = names;
+    sort(sorted.begin(), sorted.end());
+    for (size_t i = 0; i < inputs.size(); ++i) {
+        bool repeated = upper_bound(sorted.begin(), sorted.end(), names[i]) - lower_bound(sorted.begin(), sorted.end(), names[i]) > 1;
+        string name = repeated ? to_string(i) + "-" + names[i] : names[i];
+        results[i].input = inputs[i];
+        results[i].output = (filesystem::path(options.outputDirectory) / (name + "-segmented.png")).string();
+    }
+
+    _MemoryBudget budget(options.memoryBudget);
+    mutex printLock;
+
+    parallelFor(inputs.size(), options.threads, [&](size_t i) {
+        BatchResult& result = results[i];
+        size_t reserved = 0;
+        auto start = chrono::steady_clock::now();
+        try {
+            readImageSize(result.input, result.width, result.height);
+            reserved = BATCH_BYTES_PER_PIXEL * result.width * result.height;
+            budget.acquire(reserved);
+            start = chrono::steady_clock::now();
+            result.components = segmentImageFile(result.input, result.output, options.mode, options.minSize);
+        } catch (const exception& e) {
+            result.error = e.what();
+        }
+        budget.release(reserved);
+        result.seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+
+        if (options.verbose) {
+            lock_guard<mutex> guard(printLock);
+            if (result.error.empty()) {
+                double megapixels = result.width * double(result.height) / 1e6;
+                cout << result.input << " (" << result.width << "x" << result.height << "): "
+                     << result.components << " componentes, " << result.seconds * 1000 << " ms, "
+                     << megapixels / result.seconds << " MP/s -> " << result.output << endl;
+            } else {
+                cout << result.input << ": Erro: " << result.error << endl;
+            }
+        }
+    });
+
+    return results;
+}
+
+#endif // BATCHSEGMENTATION_HPP
@@ -0,0 +1,172 @@
+#ifndef CONCURRENTDISJOINTSET_HPP // Check if CONCURRENTDISJOINTSET_HPP is not defined
+#define CONCURRENTDISJOINTSET_HPP // Define CONCURRENTDISJOINTSET_HPP
+
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+#include "./DisjointSet.hpp"
+#include "./structures.hpp"
+#include "../../common/Image.hpp"
+
+using namespace std;
+
+
+/**
+ * @class ConcurrentDisjointSet
+ * @brief Union-Find that many threads may update at the same time, without locks
+ *
+ * Every parent pointer is an atomic 32 bit index (4 bytes per element):
+ * - unionSets links two roots with a single compare-and-swap on the parent of the
+ *   root with the larger index, which is attached under the smaller one. Parents
+ *   therefore always have smaller indexes and no cycle can ever be formed.
+ * - find uses path halving: each visited node tries to skip to its grandparent with
+ *   a compare-and-swap. A failed attempt only means another thread already moved
+ *   that pointer further up, so it is simply ignored.
+ *
+ * Operations are lock-free (some thread always makes progress), not wait-free: a
+ * unionSets whose compare-and-swap loses a race retries from the new roots.
+ *
+ * Since the root of a set is always its smallest element, the final labels do not
+ * depend on the number of threads nor on the order of the operations.
+ *
+ * @note Unlike DisjointSet, sets carry no size or weight: the segmentation criterion
+ *       depends on the order of the merges, only order-free merges belong here
+ *       (e.g. connected components of the edges below a weight).
+ */
+class ConcurrentDisjointSet {
+ private:
+    int count;                            // Number of elements
+    unique_ptr<atomic<uint32_t>[]> parent; // Tracks the parent of each element
+    atomic<int> quantity;                 // Number of sets
+
+ public:
+    // Constructor: Initialize the data structure
+    explicit ConcurrentDisjointSet(int n) : count(n), parent(new atomic<uint32_t>[n]), quantity(n) {
+        if (n < 0) {
+            throw invalid_argument("ConcurrentDisjointSet: negative size");
+        }
+        for (int i = 0; i < n; ++i) {
+            parent[i].store(i, memory_order_relaxed); // Each element is its own parent initially
+        }
+    }
+
+    // Moving is only safe while no other thread uses the structure
+    ConcurrentDisjointSet(ConcurrentDisjointSet&& other)
+        : count(other.count), parent(move(other.parent)), quantity(other.quantity.load()) {}
+
+    // Find operation with concurrent path halving
+    int find(int x) {
+        while (true) {
+            uint32_t p = parent[x].load(memory_order_acquire);
+            if (p == static_cast<uint32_t>(x)) return x;
+            uint32_t grandparent = parent[p].load(memory_order_acquire);
+            if (grandparent == p) return p;
+            parent[x].compare_exchange_weak(p, grandparent, memory_order_release, memory_order_relaxed);
+            x = grandparent;
+        }
+    }
+
+    /**
+     * Union operation: joins the sets of x and y
+     *
+     * @return true if this call joined two different sets, false if they were already one
+     */
+    bool unionSets(int x, int y) {
+        while (true) {
+            x = find(x);
+            y = find(y);
+            if (x == y) return false;
+            if (x < y) swap(x, y); // The larger root is attached under the smaller one
+
+            uint32_t expected = x;
+            if (parent[x].compare_exchange_strong(expected, y, memory_order_acq_rel, memory_order_acquire)) {
+                quantity.fetch_sub(1, memory_order_relaxed);
+                return true;
+            }
+            // x stopped being a root meanwhile: retry from the current roots
+        }
+    }
+
+    /**
+     * Utility to check if two elements are in the same set
+     *
+     * The answer is exact at some instant during the call: a different pair of roots
+     * is only reported once x is seen to still be a root after both finds.
+     */
+    bool isSameSet(int x, int y) {
+        while (true) {
+            x = find(x);
+            y = find(y);
+            if (x == y) return true;
+            if (parent[x].load(memory_order_acquire) == static_cast<uint32_t>(x)) return false;
+        }
+    }
+
+    int getQuantity() const {
+        return quantity.load(memory_order_relaxed);
+    }
+
+    int size() const {
+        return count;
+    }
+
+    // Image where each pixel holds the smallest element of its set (element y * width + x)
+    Image<Label> toImage(int width, int height) {
+        Image<Label> labels(width, height);
+        for (int y = 0; y < height; ++y) {
+            Label* row = labels.row(y);
+            for (int x = 0; x < width; ++x) {
+                row[x] = find(y * width + x);
+            }
+        }
+        return labels;
+    }
+};
+
+
+/**
+ * @brief Parallel connected-component labelling of a graph
+ *
+ * Joins the two vertexes of every edge whose weight is at most maxWeight. The edge
+ * list is split in one contiguous block per thread and all threads update the same
+ * ConcurrentDisjointSet, without any lock.
+ *
+ * @param n The number of nodes in the graph.
+ * @param edges Edges of the graph, in any order (e.g. from createEdgeList)
+ * @param maxWeight Edges heavier than this are ignored
+ * @param threads Number of threads
+ *
+ * @return The components, identical for any number of threads.
+ */
+ConcurrentDisjointSet connectedComponents(int n, const vector<Edge>& edges, int maxWeight, int threads) {
+    ConcurrentDisjointSet ds(n);
+    threads = max(1, threads);
+
+    auto work = [&](size_t first, size_t last) {
+        for (size_t i = first; i < last; ++i) {
+            if (edges[i].weight <= maxWeight) {
+                ds.unionSets(edges[i].v1, edges[i].v2);
+            }
+        }
+    };
+
+    if (threads == 1) {
+        work(0, edges.size());
+        return ds;
+    }
+
+    vector<thread> workers;
+    for (int t = 0; t < threads; ++t) {
+        size_t first = edges.size() * t / threads;
+        size_t last = edges.size() * (t + 1) / threads;
+        workers.emplace_back(work, first, last);
+    }
+    for (thread& worker : workers) worker.join();
+    return ds;
+}
+
+#endif // CONCURRENTDISJOINTSET_HPP
@@ -4,10 +4,91 @@
 #include <iostream>
 #include <vector>
 #include <climits>
+#include <limits>
+#include <cstdint>
+#include <stdexcept>
 #include "./structures.hpp"
+#include "../../common/Image.hpp"
 
 using namespace std;
 
+typedef uint32_t Label; // Component label of a pixel
+
+
+/**
+ * @class ComponentStats
+ * @brief Properties of one component of a finalized segmentation
+ */
+struct ComponentStats {
+    uint32_t size;                     // Number of pixels
+    int left, top, right, bottom;      // Bounding box, inclusive
+    double meanIntensity;              // Mean grey level of the pixels
+};
+
+
+/**
+ * @class Components
+ * @brief Dense labelling of a segmentation (see DisjointSet::finalize)
+ *
+ * labels holds, for every pixel, the index of its component in stats (0..k-1).
+ */
+struct Components {
+    Image<Label> labels;
+    vector<ComponentStats> stats;
+};
+
+
+/**
+ * Numbers the sets of a partition of the pixels densely and gathers their statistics
+ *
+ * Components are numbered 0..k-1 in order of first appearance in a row by row scan.
+ *
+ * @param image Image that was segmented (element y * width + x), used for the mean intensity
+ * @param rootCount Roots returned by rootOf are below this value
+ * @param expectedCount Expected number of components, used to reserve memory
+ * @param rootOf Returns an identifier of the set of an element, the same for all its elements
+ * @return Label image with the dense labels and the statistics of each component
+ */
+template <typename RootOf>
+Components _labelComponents(ImageView<const Pixel> image, size_t rootCount, size_t expectedCount, RootOf rootOf) {
+    int width = image.getWidth();
+    int height = image.getHeight();
+    const Label unset = numeric_limits<Label>::max();
+    vector<Label> denseLabel(rootCount, unset); // Indexed by root
+    vector<uint64_t> intensitySum;
+
+    Components result{Image<Label>(width, height), {}};
+    result.stats.reserve(expectedCount);
+    intensitySum.reserve(expectedCount);
+
+    for (int y = 0; y < height; ++y) {
+        const Pixel* pixels = image.row(y);
+        Label* row = result.labels.row(y);
+        for (int x = 0; x < width; ++x) {
+            int root = rootOf(y * width + x);
+
+            Label label = denseLabel[root];
+            if (label == unset) {
+                label = denseLabel[root] = static_cast<Label>(result.stats.size());
+                result.stats.push_back({0, x, y, x, y, 0.0});
+                intensitySum.push_back(0);
+            }
+            row[x] = label;
+
+            ComponentStats& stats = result.stats[label];
+            stats.size++;
+            stats.left = min(stats.left, x);
+            stats.right = max(stats.right, x);
+            stats.bottom = y; // Rows are scanned in increasing order
+            intensitySum[label] += pixels[x];
+        }
+    }
+
+    for (size_t label = 0; label < result.stats.size(); ++label) {
+        result.stats[label].meanIntensity = static_cast<double>(intensitySum[label]) / result.stats[label].size;
+    }
+    return result;
+}
 
 
 /**
@@ -15,110 +96,118 @@ using namespace std;
  * @brief Implements a Disjoint Set (Union-Find) data structure with additional functionalities for segmentation.
  * 
  * Provides an efficient data structure for managing disjoint sets, with support for:
- * - Union-Find operations with rank and path compression optimizations.
+ * - Union-Find operations with union by size and iterative path halving.
  * - Tracking additional properties of sets, such as maximum edge weight and size.
  *   
  * As opposed to the ordinary data structure, this data structure includes additional fields such as 
  * maximum edge weight and size. These fields are used for efficient discovery of each set properties.
  * 
+ * Every element is one 8 byte Node. A root has no parent, so its parent field holds
+ * ROOT_TAG + the maximum weight of its set instead, and its size field the size of
+ * the set: all the metadata of a set is read with the same cache line as its root.
+ * Up to MAX_ELEMENTS elements (a little under 4G) and weights up to MAX_WEIGHT are supported.
+ * 
  * @note The class is primarily used for image segmentation and other graph-based algorithms.
  */
 class DisjointSet {
+ public:
+    static constexpr uint32_t ROOT_TAG = 0xFFFF0000u;   // Parent values from here on mark a root
+    static constexpr uint32_t MAX_ELEMENTS = ROOT_TAG;  // Element indexes must stay below the tag
+    static constexpr int MAX_WEIGHT = 0xFFFF;           // Larger weights are saturated
+
  private:
+    struct Node {
+        uint32_t parent; // Parent index, or ROOT_TAG + maximum weight of the set for a root
+        uint32_t size;   // Size of the set, only meaningful for a root
+    };
+
     int quantity; // Number of sets
-    vector<int> parent; // Tracks the parent of each element
-    vector<int> rank;   // Tracks the rank (approximate tree height)
-    vector<int> maxWeight;   // Tracks the maximum edge of each set
-    vector<int> size;   // Tracks the size of each set
+    vector<Node> nodes;
 
 
-    // Update the maximum weight of a conjunct
-    void updateWeight(int weight, int parent) {
-        if(weight > maxWeight[find(parent)]) {
-            maxWeight[find(parent)] = weight;
+    static bool isRoot(const Node& node) {
+        return node.parent >= ROOT_TAG;
+    }
+
+    // Calculate the threshold of a conjunct given its root
+    int Threshold(int root, int k) const {
+        return k / static_cast<int>(nodes[root].size);
+    }
+ public:
+    // Constructor: Initialize the data structure
+    DisjointSet(int n) : quantity(n), nodes(n, Node{ROOT_TAG, 1}) {
+        if (static_cast<uint64_t>(n) > MAX_ELEMENTS) {
+            throw length_error("DisjointSet: too many elements");
         }
     }
-    
-    // Find operation with path compression
+
+    // Find operation with path halving: every visited node skips to its grandparent
     int find(int x) {
-        if (parent[x] != x) {
-            parent[x] = find(parent[x]); // Path compression
+        while (true) {
+            uint32_t p = nodes[x].parent;
+            if (p >= ROOT_TAG) return x;
+            uint32_t grandparent = nodes[p].parent;
+            if (grandparent >= ROOT_TAG) return p;
+            nodes[x].parent = grandparent;
+            x = grandparent;
         }
-        return parent[x];
+    }
+
+    // Get the size of a conjunct
+    int getSize(int x) {
+        return nodes[find(x)].size;
     }
 
     // Get the maximum weight of a conjunct
     int getMaxWeight(int x) {
-        return maxWeight[find(x)];
+        return nodes[find(x)].parent - ROOT_TAG;
     }
 
-    // Update the size of a conjunct
-    void updateSize(int x) {
-        size[find(x)]++;
-    }
+    /**
+     * Joins the sets of two different roots through an edge of the given weight
+     *
+     * Union by size: the root of the smaller set is attached under the other one,
+     * which keeps the size, the maximum weight and the new root together.
+     *
+     * @return The root of the joined set
+     */
+    int linkRoots(int rootX, int rootY, int weight) {
+        if (nodes[rootX].size < nodes[rootY].size) {
+            swap(rootX, rootY);
+        }
+        uint32_t maxWeight = max(nodes[rootX].parent, nodes[rootY].parent) - ROOT_TAG;
+        maxWeight = max(maxWeight, static_cast<uint32_t>(min(max(weight, 0), MAX_WEIGHT)));
 
-    // Calculate the threshold of a conjunct
-    int Threshold(int x, int k) {
-        return k/getSize(x);
-    }
- public:
-     // Get the size of a conjunct
-    int getSize(int x) {
-        return size[find(x)];
+        nodes[rootY].parent = rootX;
+        nodes[rootX].parent = ROOT_TAG + maxWeight;
+        nodes[rootX].size += nodes[rootY].size;
+        quantity--; // Decrement the number of sets
+        return rootX;
     }
-    
-    // Constructor: Initialize the data structure
-    DisjointSet(int n) {
-        parent.resize(n);
-        rank.resize(n, 0); // Initialize all ranks to 0
-        maxWeight.resize(n, 0); // Initialize all weight to 0
-        size.resize(n, 1); // Initialize all size to 1
-        quantity = n;
-        for (int i = 0; i < n; ++i) {
-            parent[i] = i; // Each element is its own parent initially
-        }
+
+    // Get the minimum internal difference of two disjoint conjuncts given their roots
+    int MinIntRoots(int rootA, int rootB, int k) const {
+        int weightA = nodes[rootA].parent - ROOT_TAG;
+        int weightB = nodes[rootB].parent - ROOT_TAG;
+        return min(weightA + Threshold(rootA, k), weightB + Threshold(rootB, k));
     }
 
-    // Union operation with rank optimization
+    // Union operation of two elements; the new set keeps the largest maximum weight
     void unionSets(int x, int y) {
         int rootX = find(x);
         int rootY = find(y);
-
         if (rootX != rootY) {
-            if (rank[rootX] > rank[rootY]) {
-                parent[rootY] = rootX; // Attach the smaller tree under the larger one
-            } else if (rank[rootX] < rank[rootY]) {
-                parent[rootX] = rootY;
-            } else {
-                parent[rootY] = rootX;
-                rank[rootX]++; // Increment rank if both trees are of the same height
-            }
-            quantity--; // Decrement the number of sets
+            linkRoots(rootX, rootY, 0);
         }
     }
 
-    // Union operation with rank optimization of an edge
+    // Union operation of an edge, which may raise the maximum weight of the new set
     void unionSets(Edge e) {
         int rootX = find(e.v1);
         int rootY = find(e.v2);
-
         if (rootX != rootY) {
-            if (rank[rootX] > rank[rootY]) {
-                parent[rootY] = rootX; // Attach the smaller tree under the larger one
-                updateWeight(e.weight, rootY);
-                updateSize(rootX);
-            } else if (rank[rootX] < rank[rootY]) {
-                parent[rootX] = rootY;
-                updateWeight(e.weight, rootX);
-                updateSize(rootY);
-            } else {
-                parent[rootY] = rootX;
-                rank[rootX]++; // Increment rank if both trees are of the same height
-                updateWeight(e.weight, rootX);
-                updateSize(rootX);
-            }
+            linkRoots(rootX, rootY, e.weight);
         }
-        quantity--; // Decrement the number of sets
     }
 
     // Utility to check if two elements are in the same set
@@ -128,27 +217,70 @@ class DisjointSet {
 
     // Get the minimum weight of conjuncts disjoint
     int MinInt(int a, int b, int k) {
-        return min(getMaxWeight(a) + Threshold(a, k), getMaxWeight(b) + Threshold(b, k)); //Minimum of the maximum weight of the conjuncts disjoint
+        return MinIntRoots(find(a), find(b), k); //Minimum of the maximum weight of the conjuncts disjoint
     }
 
     int getQuantity() {
         return quantity;
     }
 
-    vector<vector<int>> toMatrix(int width, int height) {
-        vector<vector<int>> matrix(width, vector<int>(height));
-        for (int i = 0; i < width; ++i) {
-            for (int j = 0; j < height; ++j) {
-                matrix[i][j] = find(i * height + j);
+    /**
+     * Copies the sets of a smaller DisjointSet into the range [offset, offset + part size)
+     *
+     * Used to combine independently segmented tiles: element i of the part becomes
+     * element offset + i here. The range must still hold singleton sets.
+     */
+    void absorb(const DisjointSet& part, int offset) {
+        for (size_t i = 0; i < part.nodes.size(); ++i) {
+            Node node = part.nodes[i];
+            if (!isRoot(node)) {
+                node.parent += offset;
+            }
+            nodes[offset + i] = node;
+        }
+        quantity -= static_cast<int>(part.nodes.size()) - part.quantity;
+    }
+
+    // Image where each pixel holds the root of its set (element y * width + x)
+    Image<Label> toImage(int width, int height) {
+        Image<Label> labels(width, height);
+        for (int y = 0; y < height; ++y) {
+            Label* row = labels.row(y);
+            for (int x = 0; x < width; ++x) {
+                row[x] = find(y * width + x);
             }
         }
-        return matrix;
+        return labels;
+    }
+
+    /**
+     * Flattens every element to its root and numbers the sets densely
+     *
+     * Components are numbered 0..k-1 in order of first appearance in a row by row scan,
+     * so each set is looked up once per pixel and the labels can index plain tables.
+     * After this call every element points straight to its root.
+     *
+     * @param image Image that was segmented (element y * width + x), used for the mean intensity
+     * @return Label image with the dense labels and the statistics of each component
+     */
+    Components finalize(ImageView<const Pixel> image) {
+        return _labelComponents(image, nodes.size(), quantity, [&](int element) {
+            int root = find(element);
+            if (root != element) {
+                nodes[element].parent = root;
+            }
+            return root;
+        });
     }
 
     //----------------- Debugging functions -----------------//
     void printSets() {
-        for (int i = 0; i < parent.size(); ++i) {
-            cout << "Element: " << i << " Parent: " << parent[i] << " Rank: " << rank[i] << " MaxWeight: " << maxWeight[i] << " Size: " << size[i] << endl;
+        for (size_t i = 0; i < nodes.size(); ++i) {
+            if (isRoot(nodes[i])) {
+                cout << "Element: " << i << " Root" << " MaxWeight: " << nodes[i].parent - ROOT_TAG << " Size: " << nodes[i].size << endl;
+            } else {
+                cout << "Element: " << i << " Parent: " << nodes[i].parent << endl;
+            }
         }
     }
     // Utility to print the elements and their sets
@@ -170,6 +302,22 @@ class DisjointSet {
 };
 
 
+/**
+ * Merge step of the segmentation for one edge, with exactly two finds
+ *
+ * @return true if the sets of the two vertexes were joined
+ */
+inline bool _segmentEdge(DisjointSet& ds, const Edge& e, int k) {
+    int rootA = ds.find(e.v1);
+    int rootB = ds.find(e.v2);
+    if (rootA != rootB && e.weight <= ds.MinIntRoots(rootA, rootB, k)) {
+        ds.linkRoots(rootA, rootB, e.weight);
+        return true;
+    }
+    return false;
+}
+
+
 /** 
  * @brief Segments a graph using the DisjointSet data structure.
  * 
@@ -195,14 +343,81 @@ class DisjointSet {
  * 
  * @note The input edges should be sorted in non-decreasing order of weight for optimal results.
  */
-DisjointSet segmentation(int n, int k, std::vector<Edge> edges) {
+DisjointSet segmentation(int n, int k, const std::vector<Edge>& edges) {
+    DisjointSet ds(n);
+    for (const Edge& e : edges){
+        _segmentEdge(ds, e, k);
+    }
+    return ds;
+}
+
+
+/** 
+ * @brief Segments a graph given as weight buckets (see createBucketedEdges).
+ * 
+ * Same algorithm as the edge list version; the buckets are walked in increasing
+ * weight, which is the non decrescent order the algorithm needs.
+ * 
+ * @param n The number of nodes in the graph.
+ * @param k A constant parameter for threshold calculation.
+ * @param edges Edges grouped by weight
+ * 
+ * @return A DisjointSet representing the segmented graph.
+ */
+DisjointSet segmentation(int n, int k, const BucketedEdges& edges) {
     DisjointSet ds(n);
-    for (Edge e : edges){
-        if (!ds.isSameSet(e.v1, e.v2) && e.weight <= ds.MinInt(e.v1, e.v2, k)) {
-            ds.unionSets(e);
+    for (int w = 0; w < edges.levels(); ++w) {
+        for (size_t i = edges.start[w]; i < edges.start[w + 1]; ++i) {
+            _segmentEdge(ds, edges.edge(i, w), k);
         }
     }
     return ds;
 }
 
+
+/**
+ * Merge step of the minimum size pass for one edge
+ *
+ * @return true if the sets of the two vertexes were joined
+ */
+inline bool _mergeSmallEdge(DisjointSet& ds, const Edge& e, int minSize) {
+    int rootA = ds.find(e.v1);
+    int rootB = ds.find(e.v2);
+    if (rootA != rootB && (ds.getSize(rootA) < minSize || ds.getSize(rootB) < minSize)) {
+        ds.linkRoots(rootA, rootB, e.weight);
+        return true;
+    }
+    return false;
+}
+
+
+/** 
+ * @brief Joins every component smaller than minSize to a neighbouring one.
+ * 
+ * Post-processing step of Felzenszwalb and Huttenlocher: the edges are walked once more
+ * in non decreasing weight and the two sets of an edge are joined, without the MinInt
+ * test, whenever one of them has fewer than minSize elements. A small component is thus
+ * absorbed through its cheapest edge. The sets are joined in place, in the DisjointSet
+ * returned by segmentation(), so the pass allocates nothing.
+ * 
+ * @param ds Segmentation to update
+ * @param minSize Minimum number of elements of a component (0 or 1: nothing to do)
+ * @param edges The same edges given to segmentation()
+ */
+void mergeSmallComponents(DisjointSet& ds, int minSize, const std::vector<Edge>& edges) {
+    if (minSize <= 1) return;
+    for (const Edge& e : edges) {
+        _mergeSmallEdge(ds, e, minSize);
+    }
+}
+
+void mergeSmallComponents(DisjointSet& ds, int minSize, const BucketedEdges& edges) {
+    if (minSize <= 1) return;
+    for (int w = 0; w < edges.levels(); ++w) {
+        for (size_t i = edges.start[w]; i < edges.start[w + 1]; ++i) {
+            _mergeSmallEdge(ds, edges.edge(i, w), minSize);
+        }
+    }
+}
+
 #endif
\ No newline at end of file
@@ -4,10 +4,12 @@
 
 #include <iostream>
 #include <vector>
-#include <unordered_map>
-#include <fstream>
 #include <cmath>
-#include "./PythonScripts.hpp"
+#include "./PgmToMatrix.hpp"
+#include "./DisjointSet.hpp"
+#include "../../common/Image.hpp"
+#include "../../common/PgmWriter.hpp"
+#include "../../common/Png.hpp"
 
 
 using namespace std;
@@ -21,36 +23,34 @@ namespace colorpgm {
     * @brief Stores red green blue values
     */
     struct RGBPixel {
-        int r, g, b;
+        uint8_t r, g, b;
     };
 
 
     /**
-    * Function to remap a matrix of integers to RGB color values.
+    * Function to remap a label image to RGB color values.
     *
     * Considers a pixel as part of the background, painted as black.
     * Every group that is not the group of the background is painted as white
     *
-    * @param matrix The 2D matrix of integers to remap.
+    * @param labels The label image to remap.
     * @param groupSize The number of unique colors to use for remapping.
-    * @return A 2D vector of `RGBPixel` representing the remapped colors.
+    * @return An image of `RGBPixel` representing the remapped colors.
     */
-    vector<vector<RGBPixel>> _dualColorRepresentation(const vector<vector<int>>& matrix, int groupSize, int bgGroup) {  
-        vector<vector<RGBPixel>> rgbMatrix(matrix.size(), vector<RGBPixel>(matrix[0].size())); 
+    Image<RGBPixel> _dualColorRepresentation(ImageView<const Label> labels, int groupSize, Label bgGroup) {  
+        Image<RGBPixel> rgbImage(labels.getWidth(), labels.getHeight()); 
         
-        for (int i = 0; i < matrix.size(); i++) {
-            for (int j = 0; j < matrix[0].size(); j++) {
-            int value = matrix[i][j]; 
-            
-            if (matrix[i][j] == bgGroup) {
-                rgbMatrix[i][j] = {0, 0, 0};
+        for (int i = 0; i < labels.getHeight(); i++) {
+            for (int j = 0; j < labels.getWidth(); j++) {
+            if (labels.at(i, j) == bgGroup) {
+                rgbImage.at(i, j) = {0, 0, 0};
             } else {
-                rgbMatrix[i][j] = {255, 255, 255};
+                rgbImage.at(i, j) = {255, 255, 255};
             }
             }
         }
 
-        return rgbMatrix;
+        return rgbImage;
 
     }
 
@@ -59,12 +59,12 @@ namespace colorpgm {
     *
     * Considers top left corner pixel as always part of the background group
     *
-    * @param matrix The 2D matrix of integers to remap.
+    * @param labels The label image to remap.
     * @param groupSize The number of unique colors to use for remapping.
-    * @return A 2D vector of `RGBPixel` representing the remapped colors.
+    * @return An image of `RGBPixel` representing the remapped colors.
     */
-    vector<vector<RGBPixel>> _bgDualColorRepresentation(const vector<vector<int>>& matrix, int groupSize) {  
-        return _dualColorRepresentation(matrix, groupSize, matrix[0][0]);
+    Image<RGBPixel> _bgDualColorRepresentation(ImageView<const Label> labels, int groupSize) {  
+        return _dualColorRepresentation(labels, groupSize, labels.at(0, 0));
 
     }
 
@@ -72,170 +72,147 @@ namespace colorpgm {
 
 
     /**
-    * Function to remap a matrix of integers to RGB color values.
+    * Paints every pixel with the palette entry of its label
+    *
+    * @param labels Dense label image (see DisjointSet::finalize)
+    * @param palette Color of each label
+    * @return An image of `RGBPixel`
+    *
+    * @error If a label has no color, a runtime_error is thrown
+    */
+    Image<RGBPixel> _paletteToColorRGB(ImageView<const Label> labels, const vector<RGBPixel>& palette) {
+        Image<RGBPixel> rgbImage(labels.getWidth(), labels.getHeight());
+
+        for (int i = 0; i < labels.getHeight(); i++) {
+            const Label* row = labels.row(i);
+            RGBPixel* out = rgbImage.row(i);
+            for (int j = 0; j < labels.getWidth(); j++) {
+                if (row[j] >= palette.size()) {
+                    throw runtime_error("More unique values than available colors");
+                }
+                out[j] = palette[row[j]];
+            }
+        }
+
+        return rgbImage;
+    }
+
+
+    /**
+    * Function to remap a label image to RGB color values.
     *
     * Uses only one channel (red) and the other channels are offset of red channel by a constant (1)
     * Does not represent a lot of groups well!
     *
-    * @param matrix The 2D matrix of integers to remap.
+    * @param labels The dense label image to remap (see DisjointSet::finalize).
     * @param groupSize The number of unique colors to use for remapping.
-    * @return A 2D vector of `RGBPixel` representing the remapped colors.
+    * @return An image of `RGBPixel` representing the remapped colors.
     */
-    vector<vector<RGBPixel>> _uniqueChannelMatrixToColorRGB(const vector<vector<int>>& matrix, int groupSize) {
-        vector<vector<RGBPixel>> rgbMatrix(matrix.size(), vector<RGBPixel>(matrix[0].size()));
-
+    Image<RGBPixel> _uniqueChannelMatrixToColorRGB(ImageView<const Label> labels, int groupSize) {
         vector<int> colors(groupSize);
         int divisions = COLOR_MAX/min((groupSize-1), 255);
         for (int i = 0; i < groupSize; i++) {
             colors[i] = (divisions*i)%255;
         }
 
-        unordered_map<int, RGBPixel> colorMap; // Mapping matrix values to RGB colors
-        int k = 0;
-
-        for (int i = 0; i < matrix.size(); i++) {
-            for (int j = 0; j < matrix[0].size(); j++) {
-                int value = matrix[i][j];
-
-                // If the value is already mapped to a color, use it
-                if (colorMap.find(value) != colorMap.end()) {
-                    rgbMatrix[i][j] = colorMap[value];
-                } else {
-                    // If it's a new value, assign an RGB color
-                    if (k < groupSize) {
-                        RGBPixel newColor = {
-                            colors[k % groupSize],       // Red
-                            colors[(k + 1) % groupSize], // Green
-                            colors[(k + 2) % groupSize]  // Blue
-                        };
-
-                        colorMap[value] = newColor;
-                        rgbMatrix[i][j] = newColor;
-                        k++;
-                    } else {
-                        cerr << "Error: More unique values than available colors." << endl;
-                        return {};
-                    }
-                }
-            }
+        // Palette indexed by label
+        vector<RGBPixel> palette(groupSize);
+        for (int k = 0; k < groupSize; k++) {
+            palette[k] = {
+                static_cast<uint8_t>(colors[k % groupSize]),       // Red
+                static_cast<uint8_t>(colors[(k + 1) % groupSize]), // Green
+                static_cast<uint8_t>(colors[(k + 2) % groupSize])  // Blue
+            };
         }
 
-        return rgbMatrix;
+        return _paletteToColorRGB(labels, palette);
     }
 
 
     /**
-    * Function to remap a matrix of integers to RGB color values.
+    * Function to remap a label image to RGB color values.
     *
     * Attempts to spread colors evenly between channels
     * A step is generated where colorNum * step will result in the maximum spectrum of colors
     * 
     * Each step you move from red to green - a single step might also update all colors
     *
-    * @param matrix The 2D matrix of integers to remap.
+    * @param labels The dense label image to remap (see DisjointSet::finalize).
     * @param groupSize The number of unique colors to use for remapping.
-    * @return A 2D vector of `RGBPixel` representing the remapped colors.
+    * @return An image of `RGBPixel` representing the remapped colors.
     */
     constexpr int spectrum = 255.0 * 255.0 * 255.0;
-    vector<vector<RGBPixel>> _matrixToColorRGB(const vector<vector<int>>& matrix, int colorNum) {
-        vector<vector<RGBPixel>> rgbMatrix(matrix.size(), vector<RGBPixel>(matrix[0].size()));
-
-        // Use an unordered map to assign unique RGB colors to each value in the matrix
-        unordered_map<int, RGBPixel> colorMap;
-        
+    Image<RGBPixel> _matrixToColorRGB(ImageView<const Label> labels, int colorNum) {
         // Square root of 3 over the spectrum over colorNum
         int step = max(1, static_cast<int>(pow(spectrum / colorNum, 1.0 / 3.0)));
         
         int r = 0, g = 0, b = 0; // Initial RGB values
 
-        for (int i = 0; i < matrix.size(); i++) {
-            for (int j = 0; j < matrix[0].size(); j++) {
-                int value = matrix[i][j];
-
-                // If the value already has a color, reuse it
-                if (colorMap.find(value) != colorMap.end()) {
-                    rgbMatrix[i][j] = colorMap[value];
-                } else {
-                    // Assign a new RGB color
-                    RGBPixel newColor = { r, g, b };
-                    colorMap[value] = newColor;
-                    rgbMatrix[i][j] = newColor;
-
-                    // Increment RGB values using the calculated step
-                    r += step;
-                    if (r > 255) {
-                        r -= 256;
-                        g += step;
-                        if (g > 255) {
-                            g -= 256;
-                            b += step;
-                            if (b > 255) {
-                                cerr << "Error: Exceeded maximum color combinations." << endl;
-                                return {};
-                            }
-                        }
+        // Palette indexed by label
+        vector<RGBPixel> palette(colorNum);
+        for (int k = 0; k < colorNum; k++) {
+            palette[k] = { static_cast<uint8_t>(r), static_cast<uint8_t>(g), static_cast<uint8_t>(b) };
+
+            // Increment RGB values using the calculated step
+            r += step;
+            if (r > 255) {
+                r -= 256;
+                g += step;
+                if (g > 255) {
+                    g -= 256;
+                    b += step;
+                    if (b > 255) {
+                        throw runtime_error("Exceeded maximum color combinations");
                     }
                 }
             }
         }
 
-        return rgbMatrix;
+        return _paletteToColorRGB(labels, palette);
     }
 
 
 
 
     /**
-    * Function that creates a PGM-like file using RGB values.
+    * Function that creates an image file from the colored labels.
+    *
+    * A ".png" file name is written as PNG, any other as binary P6 (RGB) ppm.
     *
     * @param colorQuantity The number of colors in the palette.
-    * @param matrix The input matrix of integers.
+    * @param labels The input label image.
     * @param filename The name of the output file.
-    * @param colorFunction Function used to define how to convert the matrix groupings into color
+    * @param colorFunction Function used to define how to convert the label groupings into color
+    * @param mode Buffered or memory-mapped output (see savePPM)
+    *
+    * @error If the labels cannot be colored or the file cannot be written, a runtime_error is thrown
     */
     void _baseMatrixToPGM(
         int colorQuantity, 
-        vector<vector<int>> matrix, 
-        string filename,
-        vector<vector<RGBPixel>> (*colorFunction)(const vector<vector<int>>&, int)
+        ImageView<const Label> labels, 
+        const string& filename,
+        Image<RGBPixel> (*colorFunction)(ImageView<const Label>, int),
+        PnmWriteMode mode
     ) {
-        ofstream file = ofstream(filename);
-        
-        unordered_map<int, int> colorMapR, colorMapG, colorMapB;
-        vector<vector<RGBPixel>> rgbMatrix = colorFunction(matrix, colorQuantity);
-
-        if (file.is_open()) {
-            file << "P2" << endl; // P3 for ASCII RGB format
-            file << matrix[0].size() << " " << matrix.size() << endl;
-            file << "255" << endl;
-
-            for (int i = 0; i < matrix.size(); i++) {
-            for (int j = 0; j < matrix[i].size(); j++) {
-                RGBPixel value = rgbMatrix[i][j];
-                file << value.r << " " 
-                    << value.g << " " 
-                    << value.b << " ";
-            }
-            file << endl;
-            }
+        Image<RGBPixel> rgbImage = colorFunction(labels, colorQuantity);
 
-            // Call an external script if needed
-            executePythonScript(pgm3ToPngScript);
+        if (hasExtension(filename, ".png")) {
+            savePNG<RGBPixel>(filename, rgbImage, mode);
         } else {
-            cout << "Error: Unable to open file" << endl;
+            savePPM<RGBPixel>(filename, rgbImage, mode);
         }
     }
 
-    void MatrixToPGM(int colorQuantity, vector<vector<int>> matrix, string filename) {
-        _baseMatrixToPGM(colorQuantity, matrix, filename, _matrixToColorRGB);
+    void MatrixToPGM(int colorQuantity, ImageView<const Label> labels, const string& filename, PnmWriteMode mode = PnmWriteMode::Buffered) {
+        _baseMatrixToPGM(colorQuantity, labels, filename, _matrixToColorRGB, mode);
     }
 
-    void UniqueChannelMatrixToPGM(int colorQuantity, vector<vector<int>> matrix, string filename) {
-        _baseMatrixToPGM(colorQuantity, matrix, filename, _uniqueChannelMatrixToColorRGB);
+    void UniqueChannelMatrixToPGM(int colorQuantity, ImageView<const Label> labels, const string& filename, PnmWriteMode mode = PnmWriteMode::Buffered) {
+        _baseMatrixToPGM(colorQuantity, labels, filename, _uniqueChannelMatrixToColorRGB, mode);
     }
 
-    void DualRepresentationMatrixToPGM(int colorQuantity, vector<vector<int>> matrix, string filename) {
-        _baseMatrixToPGM(colorQuantity, matrix, filename, _bgDualColorRepresentation);
+    void DualRepresentationMatrixToPGM(int colorQuantity, ImageView<const Label> labels, const string& filename, PnmWriteMode mode = PnmWriteMode::Buffered) {
+        _baseMatrixToPGM(colorQuantity, labels, filename, _bgDualColorRepresentation, mode);
     }
 } 
 
@@ -0,0 +1,311 @@
+#ifndef MERGETREE_HPP // Check if MERGETREE_HPP is not defined
+#define MERGETREE_HPP // Define MERGETREE_HPP
+
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <limits>
+#include <numeric>
+#include <stdexcept>
+#include <string>
+#include <vector>
+#include "./DisjointSet.hpp"
+#include "./structures.hpp"
+#include "../../common/Image.hpp"
+#include "../../common/PgmReader.hpp"
+#include "../../common/PgmWriter.hpp"
+#include "../../common/Png.hpp"
+
+
+using namespace std;
+
+
+/**
+ * @class MergeTree
+ * @brief Dendrogram of the segmentation: the labels of any k without running the merge loop again
+ *
+ * Nodes 0..n-1 are the pixels and merge i creates node n + i from two existing nodes,
+ * joined by one edge of the minimum spanning tree. Each merge stores kMin, the scale
+ * from which it holds, and kMin never decreases along the merges: the segmentation for
+ * k is made of the nodes with kMin <= k whose parent has kMin > k, so the segmentations
+ * of all the values of k are nested and each one is read in O(n) by labelsFor.
+ *
+ * The scale of an edge is the smallest k for which the Felzenszwalb criterion
+ *
+ *     w <= Int(C) + k / |C|  for both regions C that the edge joins
+ *
+ * holds between the regions that the hierarchy itself has at scale k (see buildMergeTree).
+ *
+ * @note The direct algorithm is not nested: for a given k it rejects a merge and goes on
+ *       with different sets, so no single tree reproduces segmentation(n, k, edges) for
+ *       every k. A tree k is not the k of segmentation(): at the same k the tree is
+ *       usually much coarser (640x311-truck: 715 components against 2061 at k = 150,
+ *       345 against 1646 at k = 300, most of them different). `code --merge-tree`
+ *       reports, for each k, the direct count and countDifferingComponents; check it
+ *       on the images at hand before using a tree k in place of a direct one.
+ */
+class MergeTree {
+ public:
+    struct Merge {
+        uint32_t a, b;  // Children (pixels or earlier merges)
+        uint32_t kMin;  // Scale from which the merge holds
+    };
+
+ private:
+    static constexpr char MAGIC[4] = {'F', 'Z', 'M', 'T'};
+    static constexpr uint32_t VERSION = 1;
+
+    int width = 0;
+    int height = 0;
+    vector<Merge> merges; // In creation order: children always come before their parent
+
+ public:
+    MergeTree() = default;
+    MergeTree(int width, int height, vector<Merge> merges) : width(width), height(height), merges(move(merges)) {}
+
+    int getWidth() const { return width; }
+    int getHeight() const { return height; }
+    const vector<Merge>& getMerges() const { return merges; }
+
+    // Number of components for k, without building the labels
+    int countFor(int k) const {
+        int count = width * height;
+        for (const Merge& merge : merges) {
+            if (merge.kMin <= static_cast<uint32_t>(k)) count--;
+        }
+        return count;
+    }
+
+    /**
+     * Segmentation for one k
+     *
+     * The merges are walked from the last one down: a merge accepted for k passes the
+     * representative of its node to both children, so every pixel ends with the node
+     * of the largest accepted set that contains it.
+     *
+     * @param image Image that was segmented, used for the component statistics
+     * @param k The threshold constant
+     * @return Dense labels and statistics, in the same form as DisjointSet::finalize
+     */
+    Components labelsFor(ImageView<const Pixel> image, int k) const {
+        if (image.getWidth() != width || image.getHeight() != height) {
+            throw invalid_argument("MergeTree: image size differs from the tree");
+        }
+        uint32_t n = width * height;
+        vector<uint32_t> representative(n + merges.size());
+        iota(representative.begin(), representative.end(), 0);
+        for (size_t i = merges.size(); i-- > 0;) {
+            const Merge& merge = merges[i];
+            if (merge.kMin <= static_cast<uint32_t>(k)) {
+                representative[merge.a] = representative[merge.b] = representative[n + i];
+            }
+        }
+        return _labelComponents(image, representative.size(), countFor(k),
+                                [&](int element) { return representative[element]; });
+    }
+
+    /**
+     * Writes the tree as a binary file
+     *
+     * Layout (big-endian 32 bit words): "FZMT", version, width, height, number of merges,
+     * then a, b and kMin of every merge: 12 bytes per pixel in total.
+     */
+    void save(const string& filename, PnmWriteMode mode = PnmWriteMode::Buffered) const {
+        vector<unsigned char> header(MAGIC, MAGIC + 4);
+        _appendBigEndian32(header, VERSION);
+        _appendBigEndian32(header, width);
+        _appendBigEndian32(header, height);
+        _appendBigEndian32(header, merges.size());
+
+        _PnmOutput output(filename, header.size() + 12 * merges.size(), mode);
+        output.write(header.data(), header.size());
+        vector<unsigned char> block;
+        block.reserve(12 * 4096);
+        for (size_t i = 0; i < merges.size(); ++i) {
+            _appendBigEndian32(block, merges[i].a);
+            _appendBigEndian32(block, merges[i].b);
+            _appendBigEndian32(block, merges[i].kMin);
+            if (block.size() == block.capacity() || i + 1 == merges.size()) {
+                output.write(block.data(), block.size());
+                block.clear();
+            }
+        }
+        output.finish();
+    }
+
+    // Reads a tree written by save
+    static MergeTree load(const string& filename) {
+        MappedFile file(filename);
+        const unsigned char* bytes = file.begin();
+        if (file.size() < 20 || memcmp(bytes, MAGIC, 4) != 0 || _readBigEndian32(bytes + 4) != VERSION) {
+            throw runtime_error("Arquivo de árvore de fusões inválido.");
+        }
+        int width = _readBigEndian32(bytes + 8);
+        int height = _readBigEndian32(bytes + 12);
+        size_t count = _readBigEndian32(bytes + 16);
+        uint64_t n = static_cast<uint64_t>(width) * height;
+        if (width < 0 || height < 0 || count > n || file.size() != 20 + 12 * count) {
+            throw runtime_error("Arquivo de árvore de fusões inválido.");
+        }
+
+        vector<Merge> merges(count);
+        const unsigned char* cursor = bytes + 20;
+        for (size_t i = 0; i < count; ++i, cursor += 12) {
+            merges[i] = {_readBigEndian32(cursor), _readBigEndian32(cursor + 4), _readBigEndian32(cursor + 8)};
+            if (merges[i].a >= n + i || merges[i].b >= n + i) {
+                throw runtime_error("Arquivo de árvore de fusões inválido.");
+            }
+        }
+        return MergeTree(width, height, move(merges));
+    }
+};
+
+
+/**
+ * @class _ScaleHierarchy
+ * @brief Working hierarchy of buildMergeTree, updated one minimum spanning tree edge at a time
+ *
+ * Every node is a region: the pixels joined by the edges whose scale is at most the scale
+ * of the node. The region of a pixel for a scale k is therefore its highest ancestor
+ * whose scale is at most k. Edges arrive by increasing weight, so the maximum weight
+ * inside any region that contains the new edge is the weight of the edge itself.
+ */
+class _ScaleHierarchy {
+ private:
+    static constexpr uint32_t NONE = numeric_limits<uint32_t>::max();
+    static constexpr uint64_t INFINITE = numeric_limits<uint64_t>::max();
+
+    struct Node {
+        uint32_t parent = NONE;
+        uint32_t scale = 0;     // Scale at which the region is formed (0 for pixels)
+        uint32_t size = 1;      // Pixels in the region
+        uint32_t maxWeight = 0; // Int of the region
+    };
+    vector<Node> nodes;
+
+    uint64_t parentScale(uint32_t node) const {
+        return nodes[node].parent == NONE ? INFINITE : nodes[nodes[node].parent].scale;
+    }
+
+    // Smallest k that lets the region accept an edge of this weight: w <= Int + k / size
+    uint64_t neededK(uint32_t node, int weight) const {
+        uint64_t excess = max(weight - static_cast<int>(nodes[node].maxWeight), 0);
+        return excess * nodes[node].size;
+    }
+
+ public:
+    explicit _ScaleHierarchy(int n) : nodes(n) {
+        nodes.reserve(2 * static_cast<size_t>(n));
+    }
+
+    /**
+     * Scale of the edge between pixels x and y (in different regions at every scale)
+     *
+     * The regions of x and y are walked up together: between two consecutive node
+     * scales both regions are fixed and the criterion holds from
+     * max((w - Int(C)) * |C|) on, so the first such value inside its interval is the answer.
+     */
+    uint32_t scaleOf(uint32_t x, uint32_t y, int weight) const {
+        uint64_t lower = 0;
+        while (true) {
+            uint64_t candidate = max({lower, neededK(x, weight), neededK(y, weight)});
+            uint64_t next = min(parentScale(x), parentScale(y));
+            if (candidate < next) {
+                return static_cast<uint32_t>(min<uint64_t>(candidate, numeric_limits<uint32_t>::max()));
+            }
+            lower = next;
+            while (parentScale(x) <= lower) x = nodes[x].parent;
+            while (parentScale(y) <= lower) y = nodes[y].parent;
+        }
+    }
+
+    /**
+     * Joins the hierarchies of pixels x and y through an edge of the given weight and scale
+     *
+     * A new node joins the regions of x and y at that scale; above it, the two chains of
+     * ancestors are merged by scale, each ancestor now also holding the region of the
+     * other side at its scale.
+     */
+    void join(uint32_t x, uint32_t y, int weight, uint32_t scale) {
+        while (parentScale(x) <= scale) x = nodes[x].parent;
+        while (parentScale(y) <= scale) y = nodes[y].parent;
+
+        uint32_t current = nodes.size();
+        nodes.push_back({NONE, scale, nodes[x].size + nodes[y].size, static_cast<uint32_t>(weight)});
+        uint32_t nextX = nodes[x].parent, nextY = nodes[y].parent;
+        uint32_t sizeX = nodes[x].size, sizeY = nodes[y].size; // Sizes before the join
+        nodes[x].parent = nodes[y].parent = current;
+
+        while (nextX != NONE || nextY != NONE) {
+            bool fromX = nextY == NONE || (nextX != NONE && nodes[nextX].scale <= nodes[nextY].scale);
+            uint32_t ancestor = fromX ? nextX : nextY;
+            uint32_t oldSize = nodes[ancestor].size;
+            nodes[ancestor].size += fromX ? sizeY : sizeX;
+            nodes[ancestor].maxWeight = weight;
+            (fromX ? sizeX : sizeY) = oldSize;
+            (fromX ? nextX : nextY) = nodes[ancestor].parent;
+
+            nodes[current].parent = ancestor;
+            current = ancestor;
+        }
+        nodes[current].parent = NONE;
+    }
+};
+
+
+/**
+ * @brief Builds the merge tree of a smoothed image (see MergeTree)
+ *
+ * Walks the minimum spanning tree edges by increasing weight, as segmentation() walks
+ * the buckets, and gives each one the scale at which the criterion accepts it between
+ * the regions that exist at that scale (the hierarchical graph-based segmentation of
+ * Guimarães et al., "Hierarchizing graph-based image segmentation algorithms", 2017).
+ * The edges are then joined by increasing scale, so that kMin grows along the merges.
+ *
+ * Each edge walks the ancestors of its two pixels: the cost depends on the depth of
+ * the hierarchy, in practice a few times the cost of segmentation().
+ *
+ * @param width Width of the image
+ * @param height Height of the image
+ * @param edges Edges grouped by weight (see createBucketedEdges)
+ * @return The tree, with one merge per minimum spanning tree edge
+ */
+MergeTree buildMergeTree(int width, int height, const BucketedEdges& edges) {
+    int n = width * height;
+    DisjointSet ds(n);
+    _ScaleHierarchy hierarchy(n);
+    vector<Edge> spanningTree; // Weight holds the scale
+    spanningTree.reserve(n > 0 ? n - 1 : 0);
+
+    for (int w = 0; w < edges.levels(); ++w) {
+        for (size_t i = edges.start[w]; i < edges.start[w + 1]; ++i) {
+            Edge e = edges.edge(i, w);
+            int rootA = ds.find(e.v1);
+            int rootB = ds.find(e.v2);
+            if (rootA == rootB) continue;
+            ds.linkRoots(rootA, rootB, w);
+
+            uint32_t scale = hierarchy.scaleOf(e.v1, e.v2, w);
+            hierarchy.join(e.v1, e.v2, w, scale);
+            spanningTree.push_back({e.v1, e.v2, static_cast<int>(min<uint32_t>(scale, numeric_limits<int>::max()))});
+        }
+    }
+    stable_sort(spanningTree.begin(), spanningTree.end(),
+                [](const Edge& a, const Edge& b) { return a.weight < b.weight; });
+
+    DisjointSet components(n);
+    vector<uint32_t> node(n); // Tree node of each set, indexed by root
+    iota(node.begin(), node.end(), 0);
+    vector<MergeTree::Merge> merges;
+    merges.reserve(spanningTree.size());
+    for (const Edge& e : spanningTree) {
+        int rootA = components.find(e.v1);
+        int rootB = components.find(e.v2);
+        merges.push_back({node[rootA], node[rootB], static_cast<uint32_t>(e.weight)});
+        node[components.linkRoots(rootA, rootB, 0)] = n + merges.size() - 1;
+    }
+    return MergeTree(width, height, move(merges));
+}
+
+#endif // MERGETREE_HPP
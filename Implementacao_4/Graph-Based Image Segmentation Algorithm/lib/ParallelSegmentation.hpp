@@ -0,0 +1,128 @@
+#ifndef PARALLELSEGMENTATION_HPP // Check if PARALLELSEGMENTATION_HPP is not defined
+#define PARALLELSEGMENTATION_HPP // Define PARALLELSEGMENTATION_HPP
+
+
+#include <algorithm>
+#include <thread>
+#include <vector>
+#include "./DisjointSet.hpp"
+#include "./edges.hpp"
+
+
+using namespace std;
+
+
+static const int MIN_STRIP_ROWS = 128; // Thinner strips add more seams than parallel work
+
+
+/** 
+ * @brief Multithreaded segmentation of an image split in horizontal tiles.
+ * 
+ * The image is cut in one strip of rows per thread. Each thread builds the weight
+ * buckets of its strip and segments it with its own DisjointSet, exactly as the
+ * sequential segmentation would do with the strip alone. The strips are then copied
+ * into one DisjointSet and the edges crossing the seams between strips are merged in
+ * a final pass, in non decreasing weight, with the same MinInt criterion.
+ * 
+ * Components that touch a seam may differ from the single-threaded result, because
+ * inside each strip the merge order ignores the edges of the other strips;
+ * countDifferingComponents measures how many.
+ * 
+ * @param image Smoothed image
+ * @param k A constant parameter for threshold calculation.
+ * @param threads Number of strips (and threads); strips have at least MIN_STRIP_ROWS rows,
+ *                so small images use fewer threads, or none
+ * 
+ * @return A DisjointSet representing the segmented image, element y * width + x.
+ */
+DisjointSet parallelSegmentation(ImageView<const Pixel> image, int k, int threads) {
+    int width = image.getWidth();
+    int height = image.getHeight();
+    int strips = max(1, min(threads, height / MIN_STRIP_ROWS));
+
+    vector<int> firstRow(strips + 1);
+    for (int s = 0; s <= strips; ++s) firstRow[s] = static_cast<int>(static_cast<long long>(height) * s / strips);
+
+    // Each strip is segmented independently
+    vector<DisjointSet> parts;
+    parts.reserve(strips);
+    for (int s = 0; s < strips; ++s) parts.emplace_back(0);
+
+    vector<thread> workers;
+    for (int s = 0; s < strips; ++s) {
+        workers.emplace_back([&, s]() {
+            int rows = firstRow[s + 1] - firstRow[s];
+            BucketedEdges edges = createBucketedEdges(image.view(firstRow[s], 0, rows, width));
+            parts[s] = segmentation(rows * width, k, edges);
+        });
+    }
+    for (thread& worker : workers) worker.join();
+
+    DisjointSet ds(width * height);
+    for (int s = 0; s < strips; ++s) {
+        ds.absorb(parts[s], firstRow[s] * width);
+    }
+    parts.clear();
+
+    // Edges crossing the seams: last row of a strip to the first row of the next one
+    vector<Edge> seamEdges;
+    for (int s = 1; s < strips; ++s) {
+        int y = firstRow[s] - 1;
+        const Pixel* row = image.row(y);
+        const Pixel* below = image.row(y + 1);
+        for (int x = 0; x < width; ++x) {
+            int vertex = y * width + x;
+            if (x > 0) seamEdges.push_back({vertex, vertex + width - 1, abs(row[x] - below[x - 1])});
+            seamEdges.push_back({vertex, vertex + width, abs(row[x] - below[x])});
+            if (x + 1 < width) seamEdges.push_back({vertex, vertex + width + 1, abs(row[x] - below[x + 1])});
+        }
+    }
+    countingSortEdges(seamEdges);
+
+    for (const Edge& e : seamEdges) {
+        _segmentEdge(ds, e, k);
+    }
+
+    return ds;
+}
+
+
+/** 
+ * Counts the components of a segmentation that do not appear, with exactly the
+ * same pixels, in another segmentation of the same image
+ * 
+ * @param reference Label image taken as reference (e.g. single-threaded result)
+ * @param other Label image compared against the reference
+ * @return Number of reference components without an identical component in other
+ */
+int countDifferingComponents(ImageView<const Label> reference, ImageView<const Label> other) {
+    int width = reference.getWidth();
+    int height = reference.getHeight();
+    size_t n = static_cast<size_t>(width) * height;
+
+    // Labels are roots, so they are below n
+    const Label unset = numeric_limits<Label>::max();
+    vector<Label> match(n, unset);     // Label of other for each reference label
+    vector<char> conflict(n, false);   // Reference component split among labels of other
+    vector<uint32_t> referenceSize(n, 0), otherSize(n, 0);
+
+    for (int y = 0; y < height; ++y) {
+        for (int x = 0; x < width; ++x) {
+            Label a = reference.at(y, x);
+            Label b = other.at(y, x);
+            referenceSize[a]++;
+            otherSize[b]++;
+            if (match[a] == unset) match[a] = b;
+            else if (match[a] != b) conflict[a] = true;
+        }
+    }
+
+    int differing = 0;
+    for (size_t a = 0; a < n; ++a) {
+        if (referenceSize[a] == 0) continue;
+        if (conflict[a] || referenceSize[a] != otherSize[match[a]]) differing++;
+    }
+    return differing;
+}
+
+#endif // PARALLELSEGMENTATION_HPP
@@ -0,0 +1,65 @@
+#ifndef PARAMETERSWEEP_HPP // Check if PARAMETERSWEEP_HPP is not defined
+#define PARAMETERSWEEP_HPP // Define PARAMETERSWEEP_HPP
+
+
+#include <vector>
+#include "./DisjointSet.hpp"
+#include "./WorkerPool.hpp"
+#include "./edges.hpp"
+
+
+using namespace std;
+
+
+/**
+ * @class SweepResult
+ * @brief Segmentation of an image for one value of k
+ */
+struct SweepResult {
+    int k;
+    Components components;   // Dense labels and per-component stats; components.stats.size() is the count
+};
+
+
+/** 
+ * @brief Segments one image for several values of k, sharing all the preprocessing
+ * 
+ * The image is smoothed and its weight buckets are built once. The buckets are only
+ * read by segmentation(), so the values of k are then segmented in parallel, each
+ * thread taking the next k and using its own DisjointSet.
+ * 
+ * Memory: the buckets (about 20 bytes per pixel) are shared; each thread segmenting
+ * adds 8 bytes per pixel, and each result keeps a 4 bytes per pixel label image.
+ * 
+ * @param image Grey image to segment (not smoothed)
+ * @param ks Values of k
+ * @param threads Number of threads
+ * @param kernelSize Size of the Gaussian kernel
+ * @param sigma Standard deviation of the Gaussian kernel
+ * @param minSize Components smaller than this are merged into a neighbour (see mergeSmallComponents)
+ * 
+ * @return One result per k, in the order of ks.
+ *
+ * @error An exception thrown while segmenting one k (e.g. bad_alloc) is rethrown here
+ *        after all the threads have stopped
+ */
+vector<SweepResult> sweepThresholds(ImageView<const Pixel> image, const vector<int>& ks, int threads,
+                                    int kernelSize, double sigma, int minSize = 0) {
+    int n = image.getWidth() * image.getHeight();
+    BucketedEdges edges;
+    {
+        Image<Pixel> smoothedImage = applyGaussianFilter(image, kernelSize, sigma);
+        edges = createBucketedEdges(smoothedImage);
+    }
+
+    vector<SweepResult> results(ks.size());
+    parallelFor(ks.size(), threads, [&](size_t i) {
+        DisjointSet ds = segmentation(n, ks[i], edges);
+        mergeSmallComponents(ds, minSize, edges);
+        results[i] = SweepResult{ks[i], ds.finalize(image)};
+    });
+
+    return results;
+}
+
+#endif // PARAMETERSWEEP_HPP
@@ -7,19 +7,25 @@
 #include <vector>
 #include <string>
 #include <sstream>
+#include "./structures.hpp"
+#include <algorithm>
+#include <cctype>
+#include <cstring>
+#include <filesystem>
+#include "../../common/PgmReader.hpp"
+#include "../../common/Png.hpp"
 
 using namespace std;
 
-typedef int Pixel;
-
 /** 
  * Open readily formatted pgm image file 
  * 
- * Read and return pgm image as a matrix of integers
- * The pgm file read here is a simpler version where the values are stored as char
+ * Read and return pgm image as a single contiguous 8-bit image
+ * Both ASCII (P2) and binary (P5) files are accepted; the parsing is done by
+ * the shared loadPGM, and 16-bit files are rescaled to 8 bits
  *
  * @param filename The file name to read.
- * @return A matrix composed of a vector of vectors of int.
+ * @return The image, allocated once and moved (never copied) through the pipeline.
  *
  * @error If either the file could not be open or does not exist, 
  *        a runtime_error will be sent and the function stop
@@ -27,44 +33,123 @@ typedef int Pixel;
  * @error If the read file does not contain expected prefix, it is marked invalid 
  *        and a runtime_error will be sent
  */
-vector<vector<Pixel>> readPGM(const string& filename) {
-    ifstream file(filename);
-    if (!file.is_open()) {
-        throw runtime_error("Não foi possível abrir o arquivo.");
+Image<Pixel> readPGM(const string& filename) {
+    return loadPGM<Pixel>(filename);
+}
+
+
+// Check if a file name ends with the given extension, ignoring case (".png" also matches "a.PNG")
+bool hasExtension(const string& filename, const string& extension) {
+    return filename.size() >= extension.size()
+        && equal(extension.begin(), extension.end(), filename.end() - extension.size(), [](char a, char b) {
+               return tolower(static_cast<unsigned char>(a)) == tolower(static_cast<unsigned char>(b));
+           });
+}
+
+
+/** 
+ * Open a png or pgm image file as a grey image
+ * 
+ * PNG files are decoded in process (colour images are converted to luma, see loadPNG);
+ * any other file is read as a pgm.
+ *
+ * @param filename The file name to read.
+ * @return The grey image.
+ *
+ * @error If the file could not be open or is invalid, a runtime_error will be sent
+ */
+Image<Pixel> readImage(const string& filename) {
+    if (hasExtension(filename, ".png")) {
+        return loadPNG(filename);
     }
+    return readPGM(filename);
+}
 
-    string line;
-    getline(file, line);  // Read P2 header
-    if (line != "P2") {
-        throw runtime_error("Formato não suportado. Apenas P2 é suportado.");
+
+/** 
+ * Open a png or pgm image file as a colour image, one plane per channel
+ * 
+ * A pgm (or a grey PNG) gives three equal planes.
+ *
+ * @param filename The file name to read.
+ * @return The colour image.
+ *
+ * @error If the file could not be open or is invalid, a runtime_error will be sent
+ */
+PlanarImage<Pixel> readColorImage(const string& filename) {
+    if (hasExtension(filename, ".png")) {
+        return loadPNGPlanar(filename);
     }
+    Image<Pixel> grey = readPGM(filename);
+    PlanarImage<Pixel> image(grey.getWidth(), grey.getHeight());
+    for (int c = 0; c < 3; ++c) {
+        for (int y = 0; y < grey.getHeight(); ++y) {
+            copy(grey.row(y), grey.row(y) + grey.getWidth(), image.plane(c).row(y));
+        }
+    }
+    return image;
+}
+
+
+// Grey version of a colour image, with the same luma weights as readImage
+Image<Pixel> colorToGrey(const PlanarImage<Pixel>& image) {
+    Image<Pixel> grey(image.getWidth(), image.getHeight());
+    for (int y = 0; y < image.getHeight(); ++y) {
+        const Pixel* r = image.plane(0).row(y), * g = image.plane(1).row(y), * b = image.plane(2).row(y);
+        Pixel* row = grey.row(y);
+        for (int x = 0; x < image.getWidth(); ++x) row[x] = _luma(r[x], g[x], b[x]);
+    }
+    return grey;
+}
 
-    // Ignore comments
-    while (getline(file, line) && line[0] == '#');
 
-    // read dimensions
-    istringstream dimensions(line);
-    int width, height;
-    dimensions >> width >> height;
+/** 
+ * Read only the size of a png or pgm image, without decoding its pixels
+ *
+ * @param filename The file name to read.
+ * @param width Output with the image width.
+ * @param height Output with the image height.
+ *
+ * @error If the file could not be open or its header is invalid, a runtime_error will be sent
+ */
+void readImageSize(const string& filename, int& width, int& height) {
+    MappedFile file(filename);
+    const unsigned char* bytes = file.begin();
 
-    int maxVal;
-    file >> maxVal;
+    if (file.size() >= 24 && memcmp(bytes, _PNG_SIGNATURE, 8) == 0 && memcmp(bytes + 12, "IHDR", 4) == 0) {
+        width = _readBigEndian32(bytes + 16);
+        height = _readBigEndian32(bytes + 20);
+    } else if (file.size() >= 2 && bytes[0] == 'P' && (bytes[1] == '2' || bytes[1] == '5')) {
+        _PgmParser parser(bytes + 2, file.end());
+        width = parser.readUnsigned();
+        height = parser.readUnsigned();
+    } else {
+        throw runtime_error("Formato não suportado. Apenas PNG, P2 e P5 são suportados.");
+    }
+    if (width <= 0 || height <= 0) {
+        throw runtime_error("Tamanho de imagem inválido.");
+    }
+}
 
-    // Read pixel values
-    vector<vector<Pixel>> matrix(height, vector<Pixel>(width));
 
-    for (int x = 0; x < height; ++x) {
-        for (int y = 0; y < width; ++y) {
-            int pixelValue;
-            file >> pixelValue;
-            matrix[x][y] = pixelValue;
-            // cout << pixelValue << " ";
+/** 
+ * List the png images of a directory
+ *
+ * Uses the same extension check as readImage, so ".PNG" files are listed too.
+ *
+ * @param directory The directory to search (not recursive).
+ * @return Paths of the images, in alphabetical order.
+ */
+vector<string> listImages(const string& directory) {
+    vector<string> images;
+    for (const filesystem::directory_entry& entry : filesystem::directory_iterator(directory)) {
+        string path = entry.path().string();
+        if (entry.is_regular_file() && hasExtension(path, ".png")) {
+            images.push_back(path);
         }
-        // cout << endl;
     }
-
-    file.close();
-    return matrix;
+    sort(images.begin(), images.end());
+    return images;
 }
 
 // int main() {
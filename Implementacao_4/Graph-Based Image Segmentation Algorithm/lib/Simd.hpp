@@ -0,0 +1,253 @@
+#ifndef SIMD_HPP // Check if SIMD_HPP is not defined
+#define SIMD_HPP // Define SIMD_HPP
+
+
+#include <cstdint>
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+    #include <immintrin.h>
+    #define SIMD_X86 1 // AVX2/SSE2 kernels compiled with per-function target attributes
+#endif
+
+
+using namespace std;
+
+
+/**
+ * Row kernels with runtime CPU dispatch
+ *
+ * Each kernel has an AVX2, an SSE2 and a scalar version. The vector versions are compiled
+ * with GCC/Clang target attributes, so the program itself does not need -mavx2, and the best
+ * version supported by the running CPU is chosen once, on the first call.
+ * Other compilers and architectures always use the scalar version.
+ */
+namespace simd {
+
+    enum class Level { Scalar, SSE2, AVX2 };
+
+    // Best instruction set supported by the running CPU
+    inline Level detectLevel() {
+#ifdef SIMD_X86
+        __builtin_cpu_init();
+        if (__builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma")) return Level::AVX2;
+        if (__builtin_cpu_supports("sse2")) return Level::SSE2;
+#endif
+        return Level::Scalar;
+    }
+
+    inline Level level() {
+        static const Level detected = detectLevel();
+        return detected;
+    }
+
+
+    //----------------- dst[x] = sum(kernel[t] * src[x + t]) -----------------//
+
+    inline void _convolveRowScalar(const float* src, float* dst, int count, const float* kernel, int kernelSize) {
+        for (int x = 0; x < count; ++x) {
+            float sum = 0.0f;
+            for (int t = 0; t < kernelSize; ++t) sum += kernel[t] * src[x + t];
+            dst[x] = sum;
+        }
+    }
+
+#ifdef SIMD_X86
+    __attribute__((target("sse2")))
+    inline void _convolveRowSSE2(const float* src, float* dst, int count, const float* kernel, int kernelSize) {
+        int x = 0;
+        for (; x + 4 <= count; x += 4) {
+            __m128 sum = _mm_setzero_ps();
+            for (int t = 0; t < kernelSize; ++t) {
+                sum = _mm_add_ps(sum, _mm_mul_ps(_mm_set1_ps(kernel[t]), _mm_loadu_ps(src + x + t)));
+            }
+            _mm_storeu_ps(dst + x, sum);
+        }
+        _convolveRowScalar(src + x, dst + x, count - x, kernel, kernelSize);
+    }
+
+    __attribute__((target("avx2,fma")))
+    inline void _convolveRowAVX2(const float* src, float* dst, int count, const float* kernel, int kernelSize) {
+        int x = 0;
+        for (; x + 8 <= count; x += 8) {
+            __m256 sum = _mm256_setzero_ps();
+            for (int t = 0; t < kernelSize; ++t) {
+                sum = _mm256_fmadd_ps(_mm256_set1_ps(kernel[t]), _mm256_loadu_ps(src + x + t), sum);
+            }
+            _mm256_storeu_ps(dst + x, sum);
+        }
+        _convolveRowScalar(src + x, dst + x, count - x, kernel, kernelSize);
+    }
+#endif
+
+    inline void convolveRow(const float* src, float* dst, int count, const float* kernel, int kernelSize) {
+#ifdef SIMD_X86
+        if (level() == Level::AVX2) return _convolveRowAVX2(src, dst, count, kernel, kernelSize);
+        if (level() == Level::SSE2) return _convolveRowSSE2(src, dst, count, kernel, kernelSize);
+#endif
+        _convolveRowScalar(src, dst, count, kernel, kernelSize);
+    }
+
+
+    //----------------- acc[x] += weight * src[x] -----------------//
+
+    inline void _accumulateRowScalar(float* acc, const float* src, float weight, int count) {
+        for (int x = 0; x < count; ++x) acc[x] += weight * src[x];
+    }
+
+#ifdef SIMD_X86
+    __attribute__((target("sse2")))
+    inline void _accumulateRowSSE2(float* acc, const float* src, float weight, int count) {
+        __m128 w = _mm_set1_ps(weight);
+        int x = 0;
+        for (; x + 4 <= count; x += 4) {
+            _mm_storeu_ps(acc + x, _mm_add_ps(_mm_loadu_ps(acc + x), _mm_mul_ps(w, _mm_loadu_ps(src + x))));
+        }
+        _accumulateRowScalar(acc + x, src + x, weight, count - x);
+    }
+
+    __attribute__((target("avx2,fma")))
+    inline void _accumulateRowAVX2(float* acc, const float* src, float weight, int count) {
+        __m256 w = _mm256_set1_ps(weight);
+        int x = 0;
+        for (; x + 8 <= count; x += 8) {
+            _mm256_storeu_ps(acc + x, _mm256_fmadd_ps(w, _mm256_loadu_ps(src + x), _mm256_loadu_ps(acc + x)));
+        }
+        _accumulateRowScalar(acc + x, src + x, weight, count - x);
+    }
+#endif
+
+    inline void accumulateRow(float* acc, const float* src, float weight, int count) {
+#ifdef SIMD_X86
+        if (level() == Level::AVX2) return _accumulateRowAVX2(acc, src, weight, count);
+        if (level() == Level::SSE2) return _accumulateRowSSE2(acc, src, weight, count);
+#endif
+        _accumulateRowScalar(acc, src, weight, count);
+    }
+
+
+    //----------------- dst[x] = clamp(round(src[x]), 0, 255) for src[x] >= 0 -----------------//
+
+    inline void _storeRoundedScalar(const float* src, uint8_t* dst, int count) {
+        for (int x = 0; x < count; ++x) {
+            int value = static_cast<int>(src[x] + 0.5f);
+            dst[x] = static_cast<uint8_t>(value > 255 ? 255 : value < 0 ? 0 : value);
+        }
+    }
+
+#ifdef SIMD_X86
+    __attribute__((target("sse2")))
+    inline void _storeRoundedSSE2(const float* src, uint8_t* dst, int count) {
+        const __m128 half = _mm_set1_ps(0.5f);
+        int x = 0;
+        for (; x + 16 <= count; x += 16) {
+            __m128i a = _mm_cvttps_epi32(_mm_add_ps(_mm_loadu_ps(src + x), half));
+            __m128i b = _mm_cvttps_epi32(_mm_add_ps(_mm_loadu_ps(src + x + 4), half));
+            __m128i c = _mm_cvttps_epi32(_mm_add_ps(_mm_loadu_ps(src + x + 8), half));
+            __m128i d = _mm_cvttps_epi32(_mm_add_ps(_mm_loadu_ps(src + x + 12), half));
+            __m128i packed = _mm_packus_epi16(_mm_packs_epi32(a, b), _mm_packs_epi32(c, d));
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + x), packed);
+        }
+        _storeRoundedScalar(src + x, dst + x, count - x);
+    }
+
+    __attribute__((target("avx2,fma")))
+    inline void _storeRoundedAVX2(const float* src, uint8_t* dst, int count) {
+        const __m256 half = _mm256_set1_ps(0.5f);
+        int x = 0;
+        for (; x + 16 <= count; x += 16) {
+            __m256i a = _mm256_cvttps_epi32(_mm256_add_ps(_mm256_loadu_ps(src + x), half));
+            __m256i b = _mm256_cvttps_epi32(_mm256_add_ps(_mm256_loadu_ps(src + x + 8), half));
+            // packs works per 128-bit lane; the permute restores the pixel order
+            __m256i words = _mm256_permute4x64_epi64(_mm256_packs_epi32(a, b), 0xD8);
+            __m128i packed = _mm_packus_epi16(_mm256_castsi256_si128(words), _mm256_extracti128_si256(words, 1));
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + x), packed);
+        }
+        _storeRoundedScalar(src + x, dst + x, count - x);
+    }
+#endif
+
+    inline void storeRounded(const float* src, uint8_t* dst, int count) {
+#ifdef SIMD_X86
+        if (level() == Level::AVX2) return _storeRoundedAVX2(src, dst, count);
+        if (level() == Level::SSE2) return _storeRoundedSSE2(src, dst, count);
+#endif
+        _storeRoundedScalar(src, dst, count);
+    }
+
+    //----------------- dst[x] = round(|(r0, g0, b0)[x] - (r1, g1, b1)[x]|) -----------------//
+    // Euclidean distance between the pixels of two rows given as colour planes, 0..442.
+    // Every version rounds the single precision square root of the exact integer sum of
+    // squares with +0.5 and truncation, so they all give the same weights.
+
+    inline void _colorDistanceRowScalar(const uint8_t* r0, const uint8_t* g0, const uint8_t* b0,
+                                        const uint8_t* r1, const uint8_t* g1, const uint8_t* b1, uint16_t* dst, int count) {
+        for (int x = 0; x < count; ++x) {
+            int dr = r0[x] - r1[x], dg = g0[x] - g1[x], db = b0[x] - b1[x];
+            dst[x] = static_cast<uint16_t>(sqrtf(static_cast<float>(dr * dr + dg * dg + db * db)) + 0.5f);
+        }
+    }
+
+#ifdef SIMD_X86
+    // Squares of the differences of 8 samples, added to the 32 bit lanes of low (0..3) and high (4..7)
+    __attribute__((target("sse2")))
+    inline void _addSquaredDifferencesSSE2(const uint8_t* p, const uint8_t* q, __m128i& low, __m128i& high) {
+        const __m128i zero = _mm_setzero_si128();
+        __m128i d = _mm_sub_epi16(_mm_unpacklo_epi8(_mm_loadl_epi64(reinterpret_cast<const __m128i*>(p)), zero),
+                                  _mm_unpacklo_epi8(_mm_loadl_epi64(reinterpret_cast<const __m128i*>(q)), zero));
+        __m128i dLow = _mm_unpacklo_epi16(d, zero), dHigh = _mm_unpackhi_epi16(d, zero); // (d, 0) pairs
+        low = _mm_add_epi32(low, _mm_madd_epi16(dLow, dLow));
+        high = _mm_add_epi32(high, _mm_madd_epi16(dHigh, dHigh));
+    }
+
+    __attribute__((target("sse2")))
+    inline void _colorDistanceRowSSE2(const uint8_t* r0, const uint8_t* g0, const uint8_t* b0,
+                                      const uint8_t* r1, const uint8_t* g1, const uint8_t* b1, uint16_t* dst, int count) {
+        const __m128 half = _mm_set1_ps(0.5f);
+        int x = 0;
+        for (; x + 8 <= count; x += 8) {
+            __m128i low = _mm_setzero_si128(), high = _mm_setzero_si128();
+            _addSquaredDifferencesSSE2(r0 + x, r1 + x, low, high);
+            _addSquaredDifferencesSSE2(g0 + x, g1 + x, low, high);
+            _addSquaredDifferencesSSE2(b0 + x, b1 + x, low, high);
+            __m128i a = _mm_cvttps_epi32(_mm_add_ps(_mm_sqrt_ps(_mm_cvtepi32_ps(low)), half));
+            __m128i b = _mm_cvttps_epi32(_mm_add_ps(_mm_sqrt_ps(_mm_cvtepi32_ps(high)), half));
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + x), _mm_packs_epi32(a, b)); // Distances fit in int16
+        }
+        _colorDistanceRowScalar(r0 + x, g0 + x, b0 + x, r1 + x, g1 + x, b1 + x, dst + x, count - x);
+    }
+
+    __attribute__((target("avx2,fma")))
+    inline __m256i _squaredDifferencesAVX2(const uint8_t* p, const uint8_t* q) {
+        __m256i d = _mm256_sub_epi32(_mm256_cvtepu8_epi32(_mm_loadl_epi64(reinterpret_cast<const __m128i*>(p))),
+                                     _mm256_cvtepu8_epi32(_mm_loadl_epi64(reinterpret_cast<const __m128i*>(q))));
+        return _mm256_mullo_epi32(d, d);
+    }
+
+    __attribute__((target("avx2,fma")))
+    inline void _colorDistanceRowAVX2(const uint8_t* r0, const uint8_t* g0, const uint8_t* b0,
+                                      const uint8_t* r1, const uint8_t* g1, const uint8_t* b1, uint16_t* dst, int count) {
+        const __m256 half = _mm256_set1_ps(0.5f);
+        int x = 0;
+        for (; x + 8 <= count; x += 8) {
+            __m256i sum = _mm256_add_epi32(_mm256_add_epi32(_squaredDifferencesAVX2(r0 + x, r1 + x),
+                                                            _squaredDifferencesAVX2(g0 + x, g1 + x)),
+                                           _squaredDifferencesAVX2(b0 + x, b1 + x));
+            __m256i rounded = _mm256_cvttps_epi32(_mm256_add_ps(_mm256_sqrt_ps(_mm256_cvtepi32_ps(sum)), half));
+            __m128i packed = _mm_packs_epi32(_mm256_castsi256_si128(rounded), _mm256_extracti128_si256(rounded, 1));
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + x), packed);
+        }
+        _colorDistanceRowScalar(r0 + x, g0 + x, b0 + x, r1 + x, g1 + x, b1 + x, dst + x, count - x);
+    }
+#endif
+
+    inline void colorDistanceRow(const uint8_t* r0, const uint8_t* g0, const uint8_t* b0,
+                                 const uint8_t* r1, const uint8_t* g1, const uint8_t* b1, uint16_t* dst, int count) {
+#ifdef SIMD_X86
+        if (level() == Level::AVX2) return _colorDistanceRowAVX2(r0, g0, b0, r1, g1, b1, dst, count);
+        if (level() == Level::SSE2) return _colorDistanceRowSSE2(r0, g0, b0, r1, g1, b1, dst, count);
+#endif
+        _colorDistanceRowScalar(r0, g0, b0, r1, g1, b1, dst, count);
+    }
+}
+
+#endif // SIMD_HPP
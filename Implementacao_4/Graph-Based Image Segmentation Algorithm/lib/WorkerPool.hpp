@@ -0,0 +1,56 @@
+#ifndef WORKERPOOL_HPP // Check if WORKERPOOL_HPP is not defined
+#define WORKERPOOL_HPP // Define WORKERPOOL_HPP
+
+
+#include <algorithm>
+#include <atomic>
+#include <exception>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+
+using namespace std;
+
+
+/**
+ * @brief Runs body(i) for every i in [0, count) on up to threads threads
+ *
+ * Each thread takes the next index from a shared counter, so uneven items balance out.
+ * The calling thread is one of the workers.
+ *
+ * If body throws, the first exception is kept, no further indexes are handed out and
+ * the exception is rethrown in the calling thread once every worker has joined.
+ *
+ * @param count Number of items
+ * @param threads Number of threads (at least 1, at most count)
+ * @param body Called once per index, from any of the threads
+ */
+template <typename Body>
+void parallelFor(size_t count, int threads, Body body) {
+    atomic<size_t> next(0);
+    exception_ptr failure;
+    mutex failureLock;
+
+    auto worker = [&]() {
+        for (size_t i = next++; i < count; i = next++) {
+            try {
+                body(i);
+            } catch (...) {
+                lock_guard<mutex> guard(failureLock);
+                if (!failure) failure = current_exception();
+                next = count; // Stop handing out items
+            }
+        }
+    };
+
+    threads = max(1, static_cast<int>(min<size_t>(max(threads, 1), count)));
+    vector<thread> workers;
+    for (int t = 1; t < threads; ++t) workers.emplace_back(worker);
+    worker();
+    for (thread& w : workers) w.join();
+
+    if (failure) rethrow_exception(failure);
+}
+
+#endif // WORKERPOOL_HPP
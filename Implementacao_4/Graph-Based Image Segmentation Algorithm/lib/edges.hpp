@@ -12,9 +12,9 @@
 #include <cmath>
 #include <algorithm>
 #include "./PgmToMatrix.hpp"
-#include "./PythonScripts.hpp"
 #include "./DisjointSet.hpp"
 #include "./MatrixToPgm.hpp"
+#include "./Simd.hpp"
 
 
 
@@ -24,40 +24,18 @@ using namespace std;
 
 
 
-/** 
- * Ensures PgmMatrix is a proper matrix with rows of same size
- * 
- * @param pgmMatrix Matrix asserted
- * @return false when the assert failed and on the rows is of different size
- *         true otherwise 
- */
-bool assertPgmMatrixSize(const vector<vector<int>>& pgmMatrix) {
-    int height = pgmMatrix[0].size();
-    for (int i = 1; i < pgmMatrix.size(); i++) {
-        if (height != pgmMatrix[i].size()) return false;
-    }
-
-
-    return true;
-}
-
-
-
 /** 
  * Creates non directional edge list from image matrix
  * 
  * The edges created follow a matrix graph, where each vertex v is connected 
  * to 8 surrounding vertexes as an neighbor
  * 
- * @param pgmMatrix Base matrix 
+ * @param image Base image
  * @return List of non ordered edges
  */
-vector<Edge> createEdgeList(const vector<vector<int>>& pgmMatrix) {
-    bool validMatrix = assertPgmMatrixSize(pgmMatrix);
-    if (!validMatrix) throw invalid_argument("Invalid matrix");
-
-    int height = pgmMatrix.size();
-    int width = pgmMatrix[0].size();
+vector<Edge> createEdgeList(ImageView<const Pixel> image) {
+    int height = image.getHeight();
+    int width = image.getWidth();
 
     int edgesListSize = (height+width)*4 - width - height;
     vector<Edge> edges;
@@ -88,7 +66,7 @@ vector<Edge> createEdgeList(const vector<vector<int>>& pgmMatrix) {
 
                     //std::cout << "curVertex: " << curVertex << ", nextVertex: " << nextVertex << "\n";
 
-                    int weight = abs(pgmMatrix[i][j] - pgmMatrix[ni][nj]);
+                    int weight = abs(image.at(i, j) - image.at(ni, nj));
                     
                     //std::cout << "Weight between (" << i << ", " << j << ") and (" << ni << ", " << nj << "): " << weight << "\n";
 
@@ -111,34 +89,194 @@ vector<Edge> createEdgeList(const vector<vector<int>>& pgmMatrix) {
 
 
 /** 
- * Helper function for gaussian calculations that generates a gaussian kernel
+ * Builds the weight buckets of the 8-connected grid without materializing an edge list
+ * 
+ * Two passes over the image: the first counts how many edges fall in each weight, the
+ * second writes each edge straight into its bucket. Weights are computed row by row,
+ * for one direction at a time, by weightRow(y, direction, out), which fills out[x] for
+ * every x that has a neighbour in that direction. The first and last columns are
+ * handled apart, so the interior loop emits the 4 forward edges without bounds checks.
+ * 
+ * @param width Width of the image
+ * @param height Height of the image
+ * @param levels Number of possible weights; weights must be in [0, levels)
+ * @param weightRow Functor computing the weights of one row and direction
+ * @return Edges grouped by weight, each bucket ordered by (v1, v2)
+ */
+template <typename WeightRow>
+BucketedEdges _bucketGridEdges(int width, int height, int levels, WeightRow weightRow) {
+    typedef BucketedEdges::Direction Direction;
+    const Direction directions[] = {Direction::Right, Direction::DownLeft, Direction::Down, Direction::DownRight};
+
+    BucketedEdges buckets;
+    buckets.width = width;
+    buckets.start.assign(levels + 1, 0);
+
+    vector<vector<uint16_t>> weights(4, vector<uint16_t>(width));
+    auto computeRow = [&](int y) {
+        int directionCount = y + 1 < height ? 4 : 1; // Last row only has the right neighbour
+        for (int d = 0; d < directionCount; ++d) weightRow(y, directions[d], weights[d].data());
+        return directionCount;
+    };
+
+    // First pass: size of each bucket
+    vector<size_t> count(levels + 1, 0);
+    for (int y = 0; y < height; ++y) {
+        int directionCount = computeRow(y);
+        for (int x = 0; x + 1 < width; ++x) count[weights[Direction::Right][x]]++;
+        if (directionCount == 1) continue;
+        for (int x = 1; x < width; ++x) count[weights[Direction::DownLeft][x]]++;
+        for (int x = 0; x < width; ++x) count[weights[Direction::Down][x]]++;
+        for (int x = 0; x + 1 < width; ++x) count[weights[Direction::DownRight][x]]++;
+    }
+    for (int w = 0; w < levels; ++w) buckets.start[w + 1] = buckets.start[w] + count[w];
+
+    buckets.v1.resize(buckets.start[levels]);
+    buckets.direction.resize(buckets.start[levels]);
+    vector<size_t> cursor(buckets.start.begin(), buckets.start.end() - 1);
+
+    // Second pass: scatter in (v1, v2) order so every bucket ends up sorted
+    auto emit = [&](uint32_t vertex, int d, int x) {
+        size_t position = cursor[weights[d][x]]++;
+        buckets.v1[position] = vertex;
+        buckets.direction[position] = static_cast<uint8_t>(d);
+    };
+
+    for (int y = 0; y < height; ++y) {
+        int directionCount = computeRow(y);
+        uint32_t rowStart = static_cast<uint32_t>(y) * width;
+
+        if (directionCount == 1) {
+            for (int x = 0; x + 1 < width; ++x) emit(rowStart + x, Direction::Right, x);
+            continue;
+        }
+        if (width == 1) {
+            emit(rowStart, Direction::Down, 0);
+            continue;
+        }
+
+        emit(rowStart, Direction::Right, 0);
+        emit(rowStart, Direction::Down, 0);
+        emit(rowStart, Direction::DownRight, 0);
+        for (int x = 1; x + 1 < width; ++x) {
+            emit(rowStart + x, Direction::Right, x);
+            emit(rowStart + x, Direction::DownLeft, x);
+            emit(rowStart + x, Direction::Down, x);
+            emit(rowStart + x, Direction::DownRight, x);
+        }
+        emit(rowStart + width - 1, Direction::DownLeft, width - 1);
+        emit(rowStart + width - 1, Direction::Down, width - 1);
+    }
+
+    return buckets;
+}
+
+
+/** 
+ * Creates the weight buckets of an image, replacing createEdgeList followed by a sort
+ * 
+ * Same graph and weights as createEdgeList (8 neighbours, absolute difference of
+ * intensities), but each edge is written once, directly into its weight bucket.
+ * Peak memory goes from 24 bytes per edge (edge list plus sorted copy) to 5.
+ * 
+ * @param image Base image
+ * @return Edges grouped by weight (0..255)
+ */
+BucketedEdges createBucketedEdges(ImageView<const Pixel> image) {
+    return _bucketGridEdges(image.getWidth(), image.getHeight(), 256,
+        [&](int y, BucketedEdges::Direction direction, uint16_t* out) {
+            const Pixel* row = image.row(y);
+            const Pixel* below = y + 1 < image.getHeight() ? image.row(y + 1) : row;
+            int width = image.getWidth();
+            switch (direction) {
+                case BucketedEdges::Right:
+                    for (int x = 0; x + 1 < width; ++x) out[x] = abs(row[x] - row[x + 1]);
+                    break;
+                case BucketedEdges::DownLeft:
+                    for (int x = 1; x < width; ++x) out[x] = abs(row[x] - below[x - 1]);
+                    break;
+                case BucketedEdges::Down:
+                    for (int x = 0; x < width; ++x) out[x] = abs(row[x] - below[x]);
+                    break;
+                case BucketedEdges::DownRight:
+                    for (int x = 0; x + 1 < width; ++x) out[x] = abs(row[x] - below[x + 1]);
+                    break;
+            }
+        });
+}
+
+
+
+static const int COLOR_WEIGHT_LEVELS = 443; // Rounded Euclidean distances of 8-bit RGB pixels: 0..442
+
+
+/** 
+ * Creates the weight buckets of a colour image
+ * 
+ * Same graph as createBucketedEdges; the weight of an edge is the Euclidean distance
+ * between the RGB values of its pixels, rounded to an integer so the edges still fall
+ * in a small number of buckets and need no sort. The distances of a whole row are
+ * computed at once from the three planes (simd::colorDistanceRow).
+ * 
+ * @param image Colour image, one plane per channel
+ * @return Edges grouped by weight (0..COLOR_WEIGHT_LEVELS - 1)
+ */
+BucketedEdges createColorBucketedEdges(const PlanarImage<Pixel>& image) {
+    return _bucketGridEdges(image.getWidth(), image.getHeight(), COLOR_WEIGHT_LEVELS,
+        [&](int y, BucketedEdges::Direction direction, uint16_t* out) {
+            int below = y + 1 < image.getHeight() ? y + 1 : y;
+            const Pixel* r0 = image.plane(0).row(y), * g0 = image.plane(1).row(y), * b0 = image.plane(2).row(y);
+            const Pixel* r1 = image.plane(0).row(below), * g1 = image.plane(1).row(below), * b1 = image.plane(2).row(below);
+            int width = image.getWidth();
+            switch (direction) {
+                case BucketedEdges::Right:
+                    simd::colorDistanceRow(r0, g0, b0, r0 + 1, g0 + 1, b0 + 1, out, width - 1);
+                    break;
+                case BucketedEdges::DownLeft:
+                    simd::colorDistanceRow(r0 + 1, g0 + 1, b0 + 1, r1, g1, b1, out + 1, width - 1);
+                    break;
+                case BucketedEdges::Down:
+                    simd::colorDistanceRow(r0, g0, b0, r1, g1, b1, out, width);
+                    break;
+                case BucketedEdges::DownRight:
+                    simd::colorDistanceRow(r0, g0, b0, r1 + 1, g1 + 1, b1 + 1, out, width - 1);
+                    break;
+            }
+        });
+}
+
+
+
+
+/** 
+ * Helper function for gaussian calculations that generates a one dimensional gaussian kernel
  * Both the sigma and size can be provided to alter the effects of the smoothing
+ *
+ * The 2D gaussian is separable: the square kernel is the outer product of this
+ * kernel with itself, so normalizing the 1D kernel also normalizes the 2D one
  * 
- * @param size Size of square matrix, which can be seen as the size of its edge
+ * @param size Number of taps of the kernel
  * @param sigma Constant used to determine smoothing level
- * @return A square matrix containing the normalized kernel values
+ * @return A vector containing the normalized kernel values
  */
-vector<vector<double>> _generateGaussianKernel(int size, double sigma) {
-    vector<vector<double>> kernel(size, vector<double>(size));
+vector<float> _generateGaussianKernel(int size, double sigma) {
+    vector<double> kernel(size);
     double sum = 0.0; // To normalize the kernel
     int half = size / 2;
 
     // Create the kernel
     for (int i = 0; i < size; ++i) {
-        for (int j = 0; j < size; ++j) {
-            double x = i - half;
-            double y = j - half;
-            kernel[i][j] = exp(-(x * x + y * y) / (2 * sigma * sigma)) / (2 * M_PI * sigma * sigma);
-            sum += kernel[i][j];
-        }
+        double x = i - half;
+        kernel[i] = exp(-(x * x) / (2 * sigma * sigma));
+        sum += kernel[i];
     }
 
     // Normalize the kernel
+    vector<float> normalized(size);
     for (int i = 0; i < size; ++i)
-        for (int j = 0; j < size; ++j)
-            kernel[i][j] /= sum;
+        normalized[i] = static_cast<float>(kernel[i] / sum);
 
-    return kernel;
+    return normalized;
 }
 
 
@@ -147,48 +285,69 @@ vector<vector<double>> _generateGaussianKernel(int size, double sigma) {
  * Pixels with non similar neighboring values will be less likened
  * 
  * Both the sigma and kernel size can be provided to alter the effects of the smoothing
+ *
+ * Separable implementation: a horizontal pass followed by a vertical pass, each
+ * with kernelSize taps instead of kernelSize^2. Pixels outside the image count as 0,
+ * as in the full 2D convolution. Borders are handled outside the hot loops: each row is
+ * copied into a zero padded buffer and the vertical pass only visits rows inside the image.
+ * The inner loops run on floats through the AVX2/SSE2 kernels of Simd.hpp.
+ * Only kernelSize horizontally filtered rows are kept at a time (ring buffer).
  * 
- * @param matrix Matrix of ints containing structure data (in most cases here, an image)
+ * @param image Image to be smoothed
  * @param kernelSize Constant used to determine size of one of the square edges o the kernel
  * @param sigma Constant used to determined smoothing level
  * 
- * @return New corresponding matrix with smoothed values
+ * @return New image with smoothed values
  */
-vector<vector<int>> applyGaussianFilter(const vector<vector<int>> &matrix, int kernelSize, double sigma) {
-    int rows = matrix.size();
-    int cols = matrix[0].size();
+Image<Pixel> applyGaussianFilter(ImageView<const Pixel> image, int kernelSize, double sigma) {
+    int rows = image.getHeight();
+    int cols = image.getWidth();
     int half = kernelSize / 2;
 
     // Generate the Gaussian kernel
-    auto kernel = _generateGaussianKernel(kernelSize, sigma);
+    vector<float> kernel = _generateGaussianKernel(kernelSize, sigma);
+
+    // Create the output image (every pixel is written below)
+    Image<Pixel> filteredImage(cols, rows);
 
-    // Create an output matrix initialized to 0
-    vector<vector<int>> filteredMatrix(rows, vector<int>(cols, 0));
+    vector<float> padded(cols + 2 * half, 0.0f); // Input row with zeros on both sides
+    vector<float> ring(static_cast<size_t>(kernelSize) * cols); // Horizontally filtered rows
+    vector<float> acc(cols);
+
+    // Horizontal pass of row i, stored in the ring buffer
+    auto filterRow = [&](int i) {
+        const Pixel* source = image.row(i);
+        for (int j = 0; j < cols; ++j) padded[half + j] = source[j];
+        simd::convolveRow(padded.data(), &ring[static_cast<size_t>(i % kernelSize) * cols], cols, kernel.data(), kernelSize);
+    };
+
+    for (int i = 0; i < min(half, rows); ++i) filterRow(i);
 
-    // Apply the kernel to the matrix
     for (int i = 0; i < rows; ++i) {
-        for (int j = 0; j < cols; ++j) {
-            double sum = 0.0;
-
-            // Convolve the kernel
-            for (int ki = -half; ki <= half; ++ki) {
-                for (int kj = -half; kj <= half; ++kj) {
-                    int ni = i + ki; // Neighbor row
-                    int nj = j + kj; // Neighbor column
-
-                    // Check boundaries
-                    if (ni >= 0 && ni < rows && nj >= 0 && nj < cols) {
-                        sum += matrix[ni][nj] * kernel[ki + half][kj + half];
-                    }
-                }
-            }
+        if (i + half < rows) filterRow(i + half);
 
-            // Assign the computed value to the output matrix
-            filteredMatrix[i][j] = static_cast<int>(std::round(sum));
+        // Vertical pass over the rows inside the image
+        fill(acc.begin(), acc.end(), 0.0f);
+        for (int ki = max(-half, -i); ki <= min(half, rows - 1 - i); ++ki) {
+            const float* filtered = &ring[static_cast<size_t>((i + ki) % kernelSize) * cols];
+            simd::accumulateRow(acc.data(), filtered, kernel[ki + half], cols);
         }
+
+        // Assign the computed value to the output image
+        simd::storeRounded(acc.data(), filteredImage.row(i), cols);
     }
 
-    return filteredMatrix;
+    return filteredImage;
+}
+
+
+// Gaussian filter of a colour image: each plane is smoothed on its own, as a grey image
+PlanarImage<Pixel> applyGaussianFilter(const PlanarImage<Pixel>& image, int kernelSize, double sigma) {
+    PlanarImage<Pixel> filteredImage;
+    for (int c = 0; c < 3; ++c) {
+        filteredImage.plane(c) = applyGaussianFilter(image.plane(c), kernelSize, sigma);
+    }
+    return filteredImage;
 }
 
 
@@ -200,4 +359,56 @@ bool compareEdges(const Edge& e1, const Edge& e2) {
     return e1.v2 < e2.v2;
 }
 
+
+/** 
+ * Sorts edges by weight in linear time (counting sort)
+ * 
+ * Edge weights are differences of 8-bit pixels, so they fall in a small range
+ * (0..255) and one counting pass plus one scatter pass replace the comparison sort.
+ * The sort is stable: edges of the same weight keep their relative order. As 
+ * createEdgeList emits edges ordered by (v1, v2), the result is exactly the order 
+ * given by compareEdges
+ * 
+ * @param edges List of edges with non negative weights, sorted in place
+ */
+void countingSortEdges(vector<Edge>& edges) {
+    int maxWeight = 0;
+    for (const Edge& e : edges) maxWeight = max(maxWeight, e.weight);
+
+    // Start position of each weight in the sorted list
+    vector<size_t> start(static_cast<size_t>(maxWeight) + 2, 0);
+    for (const Edge& e : edges) start[e.weight + 1]++;
+    for (int w = 0; w <= maxWeight; ++w) start[w + 1] += start[w];
+
+    vector<Edge> sorted(edges.size());
+    for (const Edge& e : edges) sorted[start[e.weight]++] = e;
+
+    edges.swap(sorted);
+}
+
+
+/** 
+ * @enum EdgeOrdering
+ * @brief Algorithm used to sort the edges before the segmentation
+ */
+enum class EdgeOrdering {
+    Counting,   // Linear time counting sort by weight (default)
+    Comparison  // std::sort with compareEdges
+};
+
+
+/** 
+ * Sorts edges in non decreasing order of weight, ties broken by (v1, v2)
+ * 
+ * @param edges List of edges created by createEdgeList, sorted in place
+ * @param ordering Sorting algorithm; both produce the same order
+ */
+void sortEdges(vector<Edge>& edges, EdgeOrdering ordering = EdgeOrdering::Counting) {
+    if (ordering == EdgeOrdering::Counting) {
+        countingSortEdges(edges);
+    } else {
+        sort(edges.begin(), edges.end(), compareEdges);
+    }
+}
+
 #endif
\ No newline at end of file
@@ -5,12 +5,16 @@
 #include <vector>
 #include <sstream>
 #include <string> // Ensure all dependencies are included
+#include <cstdint>
+#include "../../common/Image.hpp"
 
 using std::vector;
 using std::string;
 using std::ostringstream;
 using namespace std; 
 
+typedef uint8_t Pixel; // Grey level of a pixel
+
 /**
  * @class Edge
  * @brief Edge struct used for a list of Edges without adjacency context
@@ -20,6 +24,44 @@ struct Edge {
 };
 
 
+/**
+ * @class BucketedEdges
+ * @brief Edges of the 8-connected pixel grid grouped by weight, without Edge structs
+ * 
+ * Only the 4 forward neighbours of each pixel are stored (right, down-left, down and
+ * down-right), which covers every undirected edge once. An edge takes 5 bytes: its first
+ * vertex and a direction code from which the second vertex is derived, instead of the
+ * 12 bytes of an Edge plus the copy made when sorting.
+ * 
+ * Edges of weight w are at positions [start[w], start[w + 1]). Inside a bucket they are
+ * ordered by (v1, v2), so walking the buckets in order is the same as walking an edge
+ * list sorted with compareEdges.
+ */
+struct BucketedEdges {
+    enum Direction : uint8_t { Right = 0, DownLeft = 1, Down = 2, DownRight = 3 };
+
+    int width = 0;
+    vector<size_t> start;      // Bucket boundaries, one more entry than weight levels
+    vector<uint32_t> v1;       // First vertex of each edge
+    vector<uint8_t> direction; // Direction from v1 to the second vertex
+
+    int levels() const { return static_cast<int>(start.size()) - 1; }
+    size_t size() const { return v1.size(); }
+
+    // Second vertex of the edge at position i
+    int secondVertex(size_t i) const {
+        static const int dy[] = {0, 1, 1, 1};
+        static const int dx[] = {1, -1, 0, 1};
+        return v1[i] + dy[direction[i]] * width + dx[direction[i]];
+    }
+
+    // Edge at position i of bucket w
+    Edge edge(size_t i, int w) const {
+        return {static_cast<int>(v1[i]), secondVertex(i), w};
+    }
+};
+
+
 /**
  * Obtains formatted string containing vertexes and edges of the graph
  * 
@@ -92,15 +134,16 @@ string matrixEdgeListToString(const vector<Edge>& edges, int width) {
  *    rnc0 rnc1 ... rncn
  * ]
  * 
- * @param edge Matrix
+ * @param image Image (or view) to print
  * @return String result
  */
-std::ostream& operator<<(std::ostream& os, const vector<vector<int>>& matrix) {
+template <typename T>
+std::ostream& operator<<(std::ostream& os, ImageView<T> image) {
     os << "Matrix:" << endl << "[" << endl;
-    for (const vector<int>& row : matrix) {
+    for (int i = 0; i < image.getHeight(); i++) {
         os << "  ";
-        for (const int pixel : row) {
-            os << pixel << " ";
+        for (int j = 0; j < image.getWidth(); j++) {
+            os << +image.at(i, j) << " "; // Unary + prints 8-bit pixels as numbers
         }
         os << endl;
     }
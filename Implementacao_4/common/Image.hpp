@@ -0,0 +1,153 @@
+#ifndef IMAGE_HPP // Check if IMAGE_HPP is not defined
+#define IMAGE_HPP // Define IMAGE_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <new>
+#include <numeric>
+#include <stdexcept>
+
+using namespace std;
+
+
+static const size_t IMAGE_ALIGNMENT = 64; // Byte alignment of every image row
+
+
+/**
+ * @class ImageView
+ * @brief Non-owning view of pixels laid out like an Image
+ *
+ * Cheap to copy; used to pass images between pipeline stages without copying pixels.
+ * A view may also cover a sub-rectangle of a bigger image (see Image::view).
+ *
+ * @tparam T Pixel type, const-qualified for read-only views
+ */
+template <typename T>
+class ImageView {
+ private:
+    T* pixels = nullptr;
+    int width = 0;
+    int height = 0;
+    size_t stride = 0;
+
+ public:
+    ImageView() = default;
+    ImageView(T* pixels, int width, int height, size_t stride)
+        : pixels(pixels), width(width), height(height), stride(stride) {}
+
+    // A mutable view can always be used where a read-only one is expected
+    operator ImageView<const T>() const { return ImageView<const T>(pixels, width, height, stride); }
+
+    int getWidth() const { return width; }
+    int getHeight() const { return height; }
+    size_t getStride() const { return stride; }
+
+    T* data() const { return pixels; }
+    T* row(int y) const { return pixels + y * stride; }
+    T& at(int y, int x) const { return row(y)[x]; }
+
+    // Sub-rectangle starting at (y, x)
+    ImageView<T> view(int y, int x, int viewHeight, int viewWidth) const {
+        return ImageView<T>(row(y) + x, viewWidth, viewHeight, stride);
+    }
+};
+
+
+/**
+ * @class Image
+ * @brief Owning image stored in a single contiguous, row-aligned buffer
+ *
+ * Pixels are stored row-major. Every row starts on a IMAGE_ALIGNMENT byte boundary:
+ * the stride (the distance between two rows, in elements) is padded up to a whole
+ * number of alignment blocks, so it may be larger than the width. For pixel sizes that
+ * do not divide the alignment (3-byte RGB), the stride is a multiple of 64 pixels.
+ * The whole image is one allocation, regardless of its height. Images are move-only:
+ * stages pass ImageView objects instead of copying pixels.
+ *
+ * @tparam T Pixel type (uint8_t or uint16_t for grey images)
+ */
+template <typename T>
+class Image {
+ private:
+    struct AlignedDelete {
+        void operator()(T* pointer) const {
+            ::operator delete(pointer, align_val_t(IMAGE_ALIGNMENT));
+        }
+    };
+
+    int width = 0;
+    int height = 0;
+    size_t stride = 0; // Elements between the start of two consecutive rows
+    unique_ptr<T, AlignedDelete> pixels;
+
+ public:
+    Image() = default;
+
+    // Allocates an uninitialized width x height image
+    Image(int width, int height) : width(width), height(height) {
+        if (width < 0 || height < 0) {
+            throw invalid_argument("Invalid image size");
+        }
+        // Smallest element count whose size is a multiple of the alignment (64 for 3-byte RGB pixels)
+        size_t strideUnit = IMAGE_ALIGNMENT / gcd(IMAGE_ALIGNMENT, sizeof(T));
+        stride = (static_cast<size_t>(width) + strideUnit - 1) / strideUnit * strideUnit;
+        size_t rowBytes = stride * sizeof(T);
+        if (rowBytes * height > 0) {
+            pixels.reset(static_cast<T*>(::operator new(rowBytes * height, align_val_t(IMAGE_ALIGNMENT))));
+        }
+    }
+
+    int getWidth() const { return width; }
+    int getHeight() const { return height; }
+    size_t getStride() const { return stride; }
+
+    T* data() { return pixels.get(); }
+    const T* data() const { return pixels.get(); }
+
+    T* row(int y) { return pixels.get() + y * stride; }
+    const T* row(int y) const { return pixels.get() + y * stride; }
+
+    T& at(int y, int x) { return row(y)[x]; }
+    const T& at(int y, int x) const { return row(y)[x]; }
+
+    ImageView<T> view() { return ImageView<T>(data(), width, height, stride); }
+    ImageView<const T> view() const { return ImageView<const T>(data(), width, height, stride); }
+
+    ImageView<T> view(int y, int x, int viewHeight, int viewWidth) { return view().view(y, x, viewHeight, viewWidth); }
+    ImageView<const T> view(int y, int x, int viewHeight, int viewWidth) const { return view().view(y, x, viewHeight, viewWidth); }
+
+    operator ImageView<T>() { return view(); }
+    operator ImageView<const T>() const { return view(); }
+};
+
+
+
+/**
+ * @class PlanarImage
+ * @brief Colour image stored as one Image per channel (structure of arrays)
+ *
+ * Each plane is an ordinary row-aligned Image, so per-channel stages (filters,
+ * vector kernels) run on contiguous samples of a single channel.
+ *
+ * @tparam T Sample type of every plane
+ */
+template <typename T>
+class PlanarImage {
+ private:
+    Image<T> planes[3]; // Red, green and blue
+
+ public:
+    PlanarImage() = default;
+
+    // Allocates three uninitialized width x height planes
+    PlanarImage(int width, int height) : planes{Image<T>(width, height), Image<T>(width, height), Image<T>(width, height)} {}
+
+    int getWidth() const { return planes[0].getWidth(); }
+    int getHeight() const { return planes[0].getHeight(); }
+
+    Image<T>& plane(int channel) { return planes[channel]; }
+    const Image<T>& plane(int channel) const { return planes[channel]; }
+};
+
+#endif // IMAGE_HPP
@@ -0,0 +1,240 @@
+#ifndef PGMREADER_HPP // Check if PGMREADER_HPP is not defined
+#define PGMREADER_HPP // Define PGMREADER_HPP
+
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <limits>
+#include <stdexcept>
+#include <string>
+#include <vector>
+#include "./Image.hpp"
+
+#if defined(__unix__) || defined(__APPLE__)
+    #include <fcntl.h>
+    #include <sys/mman.h>
+    #include <sys/stat.h>
+    #include <unistd.h>
+    #define PGMREADER_HAS_MMAP 1
+#endif
+
+using namespace std;
+
+
+/**
+ * @class MappedFile
+ * @brief Read-only view of a whole file
+ *
+ * Uses mmap where available, so the file is paged in on demand and never copied.
+ * On other systems the file is read into memory with a single fread.
+ *
+ * @error If the file could not be open, a runtime_error is thrown
+ */
+class MappedFile {
+ private:
+    const unsigned char* bytes = nullptr;
+    size_t length = 0;
+    vector<unsigned char> fallback; // Used when mmap is not available
+
+ public:
+    explicit MappedFile(const string& filename) {
+#ifdef PGMREADER_HAS_MMAP
+        int fd = open(filename.c_str(), O_RDONLY);
+        if (fd < 0) {
+            throw runtime_error("Não foi possível abrir o arquivo.");
+        }
+        struct stat info;
+        if (fstat(fd, &info) != 0) {
+            close(fd);
+            throw runtime_error("Não foi possível abrir o arquivo.");
+        }
+        length = info.st_size;
+        if (length > 0) {
+            void* mapped = mmap(nullptr, length, PROT_READ, MAP_PRIVATE, fd, 0);
+            if (mapped == MAP_FAILED) {
+                close(fd);
+                throw runtime_error("Não foi possível mapear o arquivo.");
+            }
+            madvise(mapped, length, MADV_SEQUENTIAL);
+            bytes = static_cast<const unsigned char*>(mapped);
+        }
+        close(fd);
+#else
+        FILE* file = fopen(filename.c_str(), "rb");
+        if (!file) {
+            throw runtime_error("Não foi possível abrir o arquivo.");
+        }
+        fseek(file, 0, SEEK_END);
+        long size = ftell(file);
+        fseek(file, 0, SEEK_SET);
+        fallback.resize(size > 0 ? size : 0);
+        length = fread(fallback.data(), 1, fallback.size(), file);
+        fclose(file);
+        bytes = fallback.data();
+#endif
+    }
+
+    ~MappedFile() {
+#ifdef PGMREADER_HAS_MMAP
+        if (bytes) {
+            munmap(const_cast<unsigned char*>(bytes), length);
+        }
+#endif
+    }
+
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    const unsigned char* begin() const { return bytes; }
+    const unsigned char* end() const { return bytes + length; }
+    size_t size() const { return length; }
+};
+
+
+/**
+ * @class _PgmParser
+ * @brief Minimal cursor over the bytes of a PGM file
+ *
+ * Hand-rolled integer parsing: no locale, no stream state, no allocation.
+ */
+class _PgmParser {
+ private:
+    const unsigned char* cursor;
+    const unsigned char* end;
+
+ public:
+    _PgmParser(const unsigned char* begin, const unsigned char* end) : cursor(begin), end(end) {}
+
+    // Skip whitespace and '#' comments (comments run until the end of the line)
+    void skipSeparators() {
+        while (cursor < end) {
+            if (*cursor == '#') {
+                while (cursor < end && *cursor != '\n') cursor++;
+            } else if (*cursor == ' ' || *cursor == '\t' || *cursor == '\n' || *cursor == '\r') {
+                cursor++;
+            } else {
+                break;
+            }
+        }
+    }
+
+    // Read the next unsigned decimal integer
+    unsigned readUnsigned() {
+        skipSeparators();
+        if (cursor >= end || *cursor < '0' || *cursor > '9') {
+            throw runtime_error("Arquivo PGM inválido ou incompleto.");
+        }
+        unsigned value = 0;
+        while (cursor < end && *cursor >= '0' && *cursor <= '9') {
+            value = value * 10 + (*cursor - '0');
+            cursor++;
+        }
+        return value;
+    }
+
+    // Read ASCII samples faster than readUnsigned: whitespace only, no comments
+    unsigned readSample() {
+        while (cursor < end && *cursor <= ' ') cursor++;
+        if (cursor >= end || *cursor < '0' || *cursor > '9') {
+            return readUnsigned(); // Slow path also handles comments and reports errors
+        }
+        unsigned value = *cursor++ - '0';
+        while (cursor < end && *cursor >= '0' && *cursor <= '9') {
+            value = value * 10 + (*cursor++ - '0');
+        }
+        return value;
+    }
+
+    // The binary raster starts after exactly one whitespace character following maxval
+    const unsigned char* rasterStart() {
+        if (cursor >= end) {
+            throw runtime_error("Arquivo PGM inválido ou incompleto.");
+        }
+        return cursor + 1;
+    }
+
+    const unsigned char* getEnd() const { return end; }
+};
+
+
+/**
+ * Open a P2 (ASCII) or P5 (binary, 8 or 16 bits) pgm image file
+ *
+ * The whole file is mapped in memory and the pixels are written straight into
+ * a single Image<T> buffer, without intermediate rows or streams.
+ *
+ * When the file maxval is larger than the maximum value of T (a 16-bit file
+ * read as uint8_t), samples are rescaled to [0, numeric_limits<T>::max()].
+ *
+ * @tparam T Pixel type of the returned image (uint8_t or uint16_t)
+ * @param filename The file name to read.
+ * @param maxValue Optional output with the maxval of the pixels returned.
+ * @return The image.
+ *
+ * @error If either the file could not be open or does not exist,
+ *        a runtime_error will be sent and the function stop
+ *
+ * @error If the read file is not a P2/P5 pgm or is truncated, it is marked
+ *        invalid and a runtime_error will be sent
+ */
+template <typename T>
+Image<T> loadPGM(const string& filename, int* maxValue = nullptr) {
+    MappedFile file(filename);
+
+    if (file.size() < 2 || file.begin()[0] != 'P' || (file.begin()[1] != '2' && file.begin()[1] != '5')) {
+        throw runtime_error("Formato não suportado. Apenas P2 e P5 são suportados.");
+    }
+    bool binary = file.begin()[1] == '5';
+
+    _PgmParser parser(file.begin() + 2, file.end());
+    int width = parser.readUnsigned();
+    int height = parser.readUnsigned();
+    unsigned maxVal = parser.readUnsigned();
+    if (width <= 0 || height <= 0 || maxVal == 0 || maxVal > 65535) {
+        throw runtime_error("Cabeçalho PGM inválido.");
+    }
+
+    const unsigned typeMax = numeric_limits<T>::max();
+    bool rescale = maxVal > typeMax;
+    auto convert = [&](unsigned sample) -> T {
+        return rescale ? static_cast<T>((sample * typeMax + maxVal / 2) / maxVal) : static_cast<T>(sample);
+    };
+
+    Image<T> image(width, height);
+    if (maxValue) {
+        *maxValue = rescale ? typeMax : maxVal;
+    }
+
+    if (binary) {
+        size_t bytesPerSample = maxVal < 256 ? 1 : 2;
+        const unsigned char* raster = parser.rasterStart();
+        if (raster + bytesPerSample * width * height > parser.getEnd()) {
+            throw runtime_error("Arquivo PGM inválido ou incompleto.");
+        }
+
+        for (int y = 0; y < height; ++y) {
+            T* row = image.row(y);
+            const unsigned char* source = raster + bytesPerSample * width * y;
+            if (bytesPerSample == 1 && sizeof(T) == 1) {
+                memcpy(row, source, width);
+            } else if (bytesPerSample == 1) {
+                for (int x = 0; x < width; ++x) row[x] = source[x];
+            } else {
+                for (int x = 0; x < width; ++x) {
+                    row[x] = convert((source[2 * x] << 8) | source[2 * x + 1]); // Big-endian samples
+                }
+            }
+        }
+    } else {
+        for (int y = 0; y < height; ++y) {
+            T* row = image.row(y);
+            for (int x = 0; x < width; ++x) {
+                row[x] = convert(parser.readSample());
+            }
+        }
+    }
+
+    return image;
+}
+
+#endif // PGMREADER_HPP
@@ -0,0 +1,224 @@
+#ifndef PGMWRITER_HPP // Check if PGMWRITER_HPP is not defined
+#define PGMWRITER_HPP // Define PGMWRITER_HPP
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <limits>
+#include <stdexcept>
+#include <string>
+#include <vector>
+#include "./Image.hpp"
+
+#if defined(__unix__) || defined(__APPLE__)
+    #include <fcntl.h>
+    #include <sys/mman.h>
+    #include <sys/stat.h>
+    #include <unistd.h>
+    #define PGMWRITER_HAS_MMAP 1
+#endif
+
+using namespace std;
+
+
+// How the bytes of a PGM/PPM file reach the disk
+enum class PnmWriteMode {
+    Buffered, // Large blocks through a single FILE*
+    Mapped    // Straight into a memory-mapped output file (Buffered where mmap is not available)
+};
+
+
+/**
+ * @class _PnmOutput
+ * @brief Sequential output of a file whose size is known in advance
+ *
+ * Buffered mode gathers the bytes in a 1 MiB block and writes whole blocks.
+ * Mapped mode sizes the file first and copies the bytes into a shared mapping,
+ * so there is no write call at all; the kernel flushes the pages.
+ *
+ * @error If the file could not be created or mapped, a runtime_error is thrown
+ */
+class _PnmOutput {
+ private:
+    static constexpr size_t BLOCK_SIZE = 1 << 20;
+
+    FILE* file = nullptr;
+    vector<unsigned char> block;
+    unsigned char* mapped = nullptr;
+    size_t length = 0;
+    size_t written = 0;
+
+    void flushBlock() {
+        if (!block.empty() && fwrite(block.data(), 1, block.size(), file) != block.size()) {
+            throw runtime_error("Erro ao escrever o arquivo.");
+        }
+        block.clear();
+    }
+
+ public:
+    _PnmOutput(const string& filename, size_t totalSize, PnmWriteMode mode) : length(totalSize) {
+#ifdef PGMWRITER_HAS_MMAP
+        if (mode == PnmWriteMode::Mapped && totalSize > 0) {
+            int fd = open(filename.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0644);
+            if (fd < 0) {
+                throw runtime_error("Não foi possível criar o arquivo.");
+            }
+            if (ftruncate(fd, totalSize) != 0) {
+                close(fd);
+                throw runtime_error("Não foi possível criar o arquivo.");
+            }
+            void* pointer = mmap(nullptr, totalSize, PROT_WRITE, MAP_SHARED, fd, 0);
+            close(fd);
+            if (pointer == MAP_FAILED) {
+                throw runtime_error("Não foi possível mapear o arquivo.");
+            }
+            mapped = static_cast<unsigned char*>(pointer);
+            return;
+        }
+#endif
+        file = fopen(filename.c_str(), "wb");
+        if (!file) {
+            throw runtime_error("Não foi possível criar o arquivo.");
+        }
+        block.reserve(min(totalSize, BLOCK_SIZE));
+    }
+
+    ~_PnmOutput() {
+#ifdef PGMWRITER_HAS_MMAP
+        if (mapped) {
+            munmap(mapped, length);
+        }
+#endif
+        if (file) {
+            fclose(file);
+        }
+    }
+
+    _PnmOutput(const _PnmOutput&) = delete;
+    _PnmOutput& operator=(const _PnmOutput&) = delete;
+
+    void write(const void* data, size_t size) {
+        if (written + size > length) {
+            throw logic_error("_PnmOutput: more bytes than announced");
+        }
+        const unsigned char* bytes = static_cast<const unsigned char*>(data);
+        written += size;
+        if (mapped) {
+            memcpy(mapped + written - size, bytes, size);
+            return;
+        }
+        while (size > 0) {
+            size_t chunk = min(size, BLOCK_SIZE - block.size());
+            block.insert(block.end(), bytes, bytes + chunk);
+            bytes += chunk;
+            size -= chunk;
+            if (block.size() == BLOCK_SIZE) flushBlock();
+        }
+    }
+
+    // Write the last block and close the file; errors are reported here, not in the destructor
+    void finish() {
+        if (file) {
+            flushBlock();
+            if (fclose(file) != 0) {
+                file = nullptr;
+                throw runtime_error("Erro ao escrever o arquivo.");
+            }
+            file = nullptr;
+        }
+    }
+};
+
+
+inline string _pnmHeader(const char* magic, int width, int height, unsigned maxValue) {
+    return string(magic) + "\n" + to_string(width) + " " + to_string(height) + "\n" + to_string(maxValue) + "\n";
+}
+
+
+/**
+ * Write a grey or label image as a binary P5 pgm file
+ *
+ * Samples take one byte when maxValue is below 256 and two big-endian bytes otherwise.
+ * Each row is converted into a buffer and written as one block.
+ *
+ * @tparam T Pixel type of the image (any unsigned integer type)
+ * @param filename The file name to write.
+ * @param image The image; every sample must be at most maxValue.
+ * @param maxValue maxval of the file, 1 to 65535 (a label image passes its largest label).
+ * @param mode Buffered or memory-mapped output.
+ *
+ * @error If maxValue is out of range or the file could not be written, a runtime_error is thrown
+ */
+template <typename T>
+void savePGM(const string& filename, ImageView<const T> image, unsigned maxValue, PnmWriteMode mode = PnmWriteMode::Buffered) {
+    if (maxValue == 0 || maxValue > 65535) {
+        throw runtime_error("Valor máximo inválido para PGM (1 a 65535).");
+    }
+    int width = image.getWidth();
+    int height = image.getHeight();
+    size_t bytesPerSample = maxValue < 256 ? 1 : 2;
+
+    string header = _pnmHeader("P5", width, height, maxValue);
+    _PnmOutput output(filename, header.size() + bytesPerSample * width * height, mode);
+    output.write(header.data(), header.size());
+
+    vector<unsigned char> row(bytesPerSample * width);
+    for (int y = 0; y < height; ++y) {
+        const T* samples = image.row(y);
+        if (bytesPerSample == 1) {
+            for (int x = 0; x < width; ++x) row[x] = static_cast<unsigned char>(samples[x]);
+        } else {
+            for (int x = 0; x < width; ++x) {
+                row[2 * x] = static_cast<unsigned char>(samples[x] >> 8); // Big-endian samples
+                row[2 * x + 1] = static_cast<unsigned char>(samples[x]);
+            }
+        }
+        output.write(row.data(), row.size());
+    }
+    output.finish();
+}
+
+template <typename T>
+void savePGM(const string& filename, ImageView<const T> image, PnmWriteMode mode = PnmWriteMode::Buffered) {
+    savePGM(filename, image, min<unsigned>(numeric_limits<T>::max(), 65535), mode);
+}
+
+
+/**
+ * Write a colour image as a binary P6 ppm file (8 bits per channel)
+ *
+ * @tparam RGB Pixel type with uint8_t members r, g and b, in this order (e.g. colorpgm::RGBPixel)
+ * @param filename The file name to write.
+ * @param image The image.
+ * @param mode Buffered or memory-mapped output.
+ *
+ * @error If the file could not be written, a runtime_error is thrown
+ */
+template <typename RGB>
+void savePPM(const string& filename, ImageView<const RGB> image, PnmWriteMode mode = PnmWriteMode::Buffered) {
+    int width = image.getWidth();
+    int height = image.getHeight();
+
+    string header = _pnmHeader("P6", width, height, 255);
+    _PnmOutput output(filename, header.size() + 3 * static_cast<size_t>(width) * height, mode);
+    output.write(header.data(), header.size());
+
+    vector<unsigned char> row(3 * width);
+    for (int y = 0; y < height; ++y) {
+        const RGB* pixels = image.row(y);
+        if (sizeof(RGB) == 3) {
+            memcpy(row.data(), pixels, row.size()); // Already packed as r, g, b
+        } else {
+            for (int x = 0; x < width; ++x) {
+                row[3 * x] = pixels[x].r;
+                row[3 * x + 1] = pixels[x].g;
+                row[3 * x + 2] = pixels[x].b;
+            }
+        }
+        output.write(row.data(), row.size());
+    }
+    output.finish();
+}
+
+#endif // PGMWRITER_HPP
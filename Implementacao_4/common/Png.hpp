@@ -0,0 +1,813 @@
+#ifndef PNG_HPP // Check if PNG_HPP is not defined
+#define PNG_HPP // Define PNG_HPP
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+#include <vector>
+#include "./Image.hpp"
+#include "./PgmReader.hpp"
+#include "./PgmWriter.hpp"
+
+using namespace std;
+
+
+/*
+ * Self-contained PNG support, so images are read and written in process
+ * without any external library or interpreter:
+ * - inflate (stored, fixed and dynamic Huffman blocks) and all PNG colour types,
+ *   bit depths and filters, interlaced or not;
+ * - deflate with LZ77 hash chains and the fixed Huffman code, enough for
+ *   segmentation results, which are made of large flat regions.
+ */
+
+
+//----------------- Checksums -----------------//
+
+inline uint32_t _crc32(const unsigned char* data, size_t size, uint32_t crc = 0) {
+    static const vector<uint32_t> table = []() {
+        vector<uint32_t> values(256);
+        for (uint32_t n = 0; n < 256; ++n) {
+            uint32_t c = n;
+            for (int k = 0; k < 8; ++k) c = c & 1 ? 0xEDB88320u ^ (c >> 1) : c >> 1;
+            values[n] = c;
+        }
+        return values;
+    }();
+    crc = ~crc;
+    for (size_t i = 0; i < size; ++i) crc = table[(crc ^ data[i]) & 0xFF] ^ (crc >> 8);
+    return ~crc;
+}
+
+inline uint32_t _adler32(const unsigned char* data, size_t size) {
+    uint32_t a = 1, b = 0;
+    while (size > 0) {
+        size_t chunk = min<size_t>(size, 5552); // Largest run without 32 bit overflow
+        for (size_t i = 0; i < chunk; ++i) {
+            a += data[i];
+            b += a;
+        }
+        a %= 65521;
+        b %= 65521;
+        data += chunk;
+        size -= chunk;
+    }
+    return (b << 16) | a;
+}
+
+inline uint32_t _readBigEndian32(const unsigned char* bytes) {
+    return (uint32_t(bytes[0]) << 24) | (uint32_t(bytes[1]) << 16) | (uint32_t(bytes[2]) << 8) | bytes[3];
+}
+
+inline void _appendBigEndian32(vector<unsigned char>& out, uint32_t value) {
+    out.push_back(value >> 24);
+    out.push_back(value >> 16);
+    out.push_back(value >> 8);
+    out.push_back(value);
+}
+
+
+//----------------- Deflate tables (RFC 1951) -----------------//
+
+static const uint16_t _LENGTH_BASE[29] = {3, 4, 5, 6, 7, 8, 9, 10, 11, 13, 15, 17, 19, 23, 27, 31,
+                                          35, 43, 51, 59, 67, 83, 99, 115, 131, 163, 195, 227, 258};
+static const uint8_t _LENGTH_EXTRA[29] = {0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2, 2,
+                                          3, 3, 3, 3, 4, 4, 4, 4, 5, 5, 5, 5, 0};
+static const uint16_t _DISTANCE_BASE[30] = {1, 2, 3, 4, 5, 7, 9, 13, 17, 25, 33, 49, 65, 97, 129, 193,
+                                            257, 385, 513, 769, 1025, 1537, 2049, 3073, 4097, 6145,
+                                            8193, 12289, 16385, 24577};
+static const uint8_t _DISTANCE_EXTRA[30] = {0, 0, 0, 0, 1, 1, 2, 2, 3, 3, 4, 4, 5, 5, 6, 6,
+                                            7, 7, 8, 8, 9, 9, 10, 10, 11, 11, 12, 12, 13, 13};
+
+inline uint32_t _reverseBits(uint32_t code, int length) {
+    uint32_t reversed = 0;
+    for (int i = 0; i < length; ++i) {
+        reversed = (reversed << 1) | (code & 1);
+        code >>= 1;
+    }
+    return reversed;
+}
+
+
+//----------------- Inflate -----------------//
+
+/**
+ * @class _BitReader
+ * @brief LSB-first bit stream over a byte range, as deflate stores it
+ */
+class _BitReader {
+ private:
+    const unsigned char* cursor;
+    const unsigned char* end;
+    uint64_t buffer = 0;
+    int count = 0;      // Valid bits in buffer
+    int overrun = 0;    // Zero bits appended past the end of the input
+
+ public:
+    _BitReader(const unsigned char* begin, const unsigned char* end) : cursor(begin), end(end) {}
+
+    void refill() {
+        while (count <= 56) {
+            if (cursor < end) {
+                buffer |= uint64_t(*cursor++) << count;
+            } else {
+                overrun++;
+            }
+            count += 8;
+        }
+    }
+
+    uint32_t peek(int bits) {
+        if (count < bits) refill();
+        return static_cast<uint32_t>(buffer & ((uint64_t(1) << bits) - 1));
+    }
+
+    void consume(int bits) {
+        buffer >>= bits;
+        count -= bits;
+        if (overrun * 8 > count) {
+            throw runtime_error("PNG inválido: dados compactados incompletos.");
+        }
+    }
+
+    uint32_t read(int bits) {
+        if (bits == 0) return 0;
+        uint32_t value = peek(bits);
+        consume(bits);
+        return value;
+    }
+
+    // Drop the bits up to the next byte boundary and return the position of that byte
+    const unsigned char* alignToByte() {
+        consume(count % 8);
+        const unsigned char* position = cursor - (count / 8 - overrun);
+        buffer = 0;
+        count = 0;
+        overrun = 0;
+        cursor = position;
+        return position;
+    }
+
+    void skipBytes(size_t bytes) {
+        cursor += bytes;
+    }
+
+    const unsigned char* getEnd() const { return end; }
+};
+
+
+/**
+ * @class _HuffmanTable
+ * @brief Canonical Huffman code decoded with a single table lookup
+ *
+ * The table is indexed by the next maxLength input bits; each entry holds
+ * the symbol and the length of its code (symbol << 4 | length).
+ */
+class _HuffmanTable {
+ private:
+    vector<uint16_t> entries;
+    int maxLength = 0;
+
+ public:
+    void build(const uint8_t* lengths, int symbols) {
+        int lengthCount[16] = {0};
+        maxLength = 0;
+        for (int s = 0; s < symbols; ++s) {
+            lengthCount[lengths[s]]++;
+            maxLength = max<int>(maxLength, lengths[s]);
+        }
+        lengthCount[0] = 0;
+        if (maxLength == 0) maxLength = 1; // Block without any code (e.g. no distances)
+
+        int nextCode[16] = {0};
+        int code = 0;
+        for (int length = 1; length <= 15; ++length) {
+            code = (code + lengthCount[length - 1]) << 1;
+            nextCode[length] = code;
+        }
+
+        entries.assign(size_t(1) << maxLength, 0);
+        for (int s = 0; s < symbols; ++s) {
+            int length = lengths[s];
+            if (length == 0) continue;
+            uint32_t reversed = _reverseBits(nextCode[length]++, length);
+            if (reversed >= entries.size()) {
+                throw runtime_error("PNG inválido: código de Huffman inválido.");
+            }
+            for (size_t index = reversed; index < entries.size(); index += size_t(1) << length) {
+                entries[index] = static_cast<uint16_t>((s << 4) | length);
+            }
+        }
+    }
+
+    int decode(_BitReader& bits) const {
+        uint16_t entry = entries[bits.peek(maxLength)];
+        if ((entry & 0xF) == 0) {
+            throw runtime_error("PNG inválido: código de Huffman inválido.");
+        }
+        bits.consume(entry & 0xF);
+        return entry >> 4;
+    }
+};
+
+
+/**
+ * Decompress a zlib stream (RFC 1950 around RFC 1951 deflate data)
+ *
+ * @param data The zlib stream.
+ * @param size Size of the stream in bytes.
+ * @param expectedSize Size of the decompressed data, used to allocate once.
+ * @return The decompressed bytes.
+ *
+ * @error If the stream is invalid or truncated, a runtime_error is thrown
+ */
+vector<unsigned char> inflateZlib(const unsigned char* data, size_t size, size_t expectedSize) {
+    if (size < 6 || (data[0] & 0x0F) != 8 || ((data[0] << 8) | data[1]) % 31 != 0 || (data[1] & 0x20)) {
+        throw runtime_error("PNG inválido: cabeçalho zlib inválido.");
+    }
+
+    vector<unsigned char> out;
+    out.reserve(expectedSize);
+
+    _BitReader bits(data + 2, data + size);
+    _HuffmanTable literals, distances;
+    bool last = false;
+
+    while (!last) {
+        last = bits.read(1);
+        int type = bits.read(2);
+
+        if (type == 0) {
+            const unsigned char* block = bits.alignToByte();
+            if (block + 4 > bits.getEnd()) {
+                throw runtime_error("PNG inválido: dados compactados incompletos.");
+            }
+            size_t length = block[0] | (block[1] << 8);
+            size_t complement = block[2] | (block[3] << 8);
+            if (length != (~complement & 0xFFFF) || block + 4 + length > bits.getEnd()) {
+                throw runtime_error("PNG inválido: bloco sem compressão inválido.");
+            }
+            out.insert(out.end(), block + 4, block + 4 + length);
+            bits.skipBytes(4 + length);
+            continue;
+        }
+
+        uint8_t lengths[320];
+        if (type == 1) {
+            int s = 0;
+            for (; s < 144; ++s) lengths[s] = 8;
+            for (; s < 256; ++s) lengths[s] = 9;
+            for (; s < 280; ++s) lengths[s] = 7;
+            for (; s < 288; ++s) lengths[s] = 8;
+            literals.build(lengths, 288);
+            fill(lengths, lengths + 30, 5);
+            distances.build(lengths, 30);
+        } else if (type == 2) {
+            static const uint8_t order[19] = {16, 17, 18, 0, 8, 7, 9, 6, 10, 5, 11, 4, 12, 3, 13, 2, 14, 1, 15};
+            int literalCount = bits.read(5) + 257;
+            int distanceCount = bits.read(5) + 1;
+            int codeLengthCount = bits.read(4) + 4;
+
+            uint8_t codeLengths[19] = {0};
+            for (int i = 0; i < codeLengthCount; ++i) codeLengths[order[i]] = bits.read(3);
+            _HuffmanTable codeLengthTable;
+            codeLengthTable.build(codeLengths, 19);
+
+            int total = literalCount + distanceCount;
+            for (int i = 0; i < total;) {
+                int symbol = codeLengthTable.decode(bits);
+                if (symbol < 16) {
+                    lengths[i++] = symbol;
+                    continue;
+                }
+                int repeat;
+                uint8_t value = 0;
+                if (symbol == 16) {
+                    if (i == 0) throw runtime_error("PNG inválido: comprimentos de código inválidos.");
+                    value = lengths[i - 1];
+                    repeat = 3 + bits.read(2);
+                } else if (symbol == 17) {
+                    repeat = 3 + bits.read(3);
+                } else {
+                    repeat = 11 + bits.read(7);
+                }
+                if (i + repeat > total) throw runtime_error("PNG inválido: comprimentos de código inválidos.");
+                fill(lengths + i, lengths + i + repeat, value);
+                i += repeat;
+            }
+            literals.build(lengths, literalCount);
+            distances.build(lengths + literalCount, distanceCount);
+        } else {
+            throw runtime_error("PNG inválido: tipo de bloco deflate inválido.");
+        }
+
+        while (true) {
+            int symbol = literals.decode(bits);
+            if (symbol < 256) {
+                out.push_back(static_cast<unsigned char>(symbol));
+                continue;
+            }
+            if (symbol == 256) break;
+
+            symbol -= 257;
+            if (symbol >= 29) throw runtime_error("PNG inválido: comprimento inválido.");
+            size_t length = _LENGTH_BASE[symbol] + bits.read(_LENGTH_EXTRA[symbol]);
+            int distanceSymbol = distances.decode(bits);
+            if (distanceSymbol >= 30) throw runtime_error("PNG inválido: distância inválida.");
+            size_t distance = _DISTANCE_BASE[distanceSymbol] + bits.read(_DISTANCE_EXTRA[distanceSymbol]);
+            if (distance > out.size()) throw runtime_error("PNG inválido: distância inválida.");
+
+            size_t from = out.size() - distance;
+            for (size_t i = 0; i < length; ++i) out.push_back(out[from + i]); // Copies may overlap
+        }
+    }
+
+    return out;
+}
+
+
+//----------------- Deflate -----------------//
+
+/**
+ * @class _BitWriter
+ * @brief LSB-first bit stream appended to a byte vector
+ */
+class _BitWriter {
+ private:
+    vector<unsigned char>& out;
+    uint64_t buffer = 0;
+    int count = 0;
+
+ public:
+    explicit _BitWriter(vector<unsigned char>& out) : out(out) {}
+
+    void write(uint32_t value, int bits) {
+        buffer |= uint64_t(value) << count;
+        count += bits;
+        while (count >= 8) {
+            out.push_back(static_cast<unsigned char>(buffer));
+            buffer >>= 8;
+            count -= 8;
+        }
+    }
+
+    // Huffman codes are sent from their most significant bit
+    void writeCode(uint32_t code, int length) {
+        write(_reverseBits(code, length), length);
+    }
+
+    void flush() {
+        if (count > 0) out.push_back(static_cast<unsigned char>(buffer));
+        buffer = 0;
+        count = 0;
+    }
+};
+
+
+inline void _writeFixedLiteral(_BitWriter& bits, int symbol) {
+    if (symbol < 144) bits.writeCode(0x30 + symbol, 8);
+    else if (symbol < 256) bits.writeCode(0x190 + symbol - 144, 9);
+    else if (symbol < 280) bits.writeCode(symbol - 256, 7);
+    else bits.writeCode(0xC0 + symbol - 280, 8);
+}
+
+inline void _writeFixedMatch(_BitWriter& bits, int length, int distance) {
+    int code = 0;
+    while (code < 28 && _LENGTH_BASE[code + 1] <= length) code++;
+    _writeFixedLiteral(bits, 257 + code);
+    bits.write(length - _LENGTH_BASE[code], _LENGTH_EXTRA[code]);
+
+    int distanceCode = 0;
+    while (distanceCode < 29 && _DISTANCE_BASE[distanceCode + 1] <= distance) distanceCode++;
+    bits.writeCode(distanceCode, 5);
+    bits.write(distance - _DISTANCE_BASE[distanceCode], _DISTANCE_EXTRA[distanceCode]);
+}
+
+
+/**
+ * Compress data into a zlib stream
+ *
+ * Greedy LZ77 over a 32 KiB window, with hash chains of 3-byte prefixes,
+ * coded as a single block with the fixed Huffman code.
+ *
+ * @param data The bytes to compress.
+ * @param size Number of bytes.
+ * @return The zlib stream.
+ */
+vector<unsigned char> deflateZlib(const unsigned char* data, size_t size) {
+    const int WINDOW = 1 << 15;
+    const int HASH_BITS = 15;
+    const int MAX_CHAIN = 32;
+    const int MIN_MATCH = 3, MAX_MATCH = 258;
+
+    vector<unsigned char> out;
+    out.reserve(size / 4 + 64);
+    out.push_back(0x78); // Deflate, 32 KiB window
+    out.push_back(0x01); // No preset dictionary, check bits
+
+    _BitWriter bits(out);
+    bits.write(1, 1); // Last block
+    bits.write(1, 2); // Fixed Huffman code
+
+    vector<int32_t> head(size_t(1) << HASH_BITS, -1);
+    vector<int32_t> previous(WINDOW, -1);
+    auto hashAt = [&](size_t i) {
+        uint32_t value = data[i] | (data[i + 1] << 8) | (data[i + 2] << 16);
+        return (value * 2654435761u) >> (32 - HASH_BITS);
+    };
+    auto insert = [&](size_t i) {
+        if (i + MIN_MATCH > size) return;
+        uint32_t hash = hashAt(i);
+        previous[i & (WINDOW - 1)] = head[hash];
+        head[hash] = static_cast<int32_t>(i);
+    };
+
+    size_t i = 0;
+    while (i < size) {
+        int bestLength = 0, bestDistance = 0;
+        if (i + MIN_MATCH <= size) {
+            int32_t candidate = head[hashAt(i)];
+            int maxLength = static_cast<int>(min<size_t>(MAX_MATCH, size - i));
+            for (int chain = 0; candidate >= 0 && chain < MAX_CHAIN; ++chain) {
+                size_t distance = i - candidate;
+                if (distance > size_t(WINDOW - 1)) break;
+                if (data[candidate + bestLength] == data[i + bestLength]) {
+                    int length = 0;
+                    while (length < maxLength && data[candidate + length] == data[i + length]) length++;
+                    if (length > bestLength) {
+                        bestLength = length;
+                        bestDistance = static_cast<int>(distance);
+                        if (length == maxLength) break;
+                    }
+                }
+                int32_t next = previous[candidate & (WINDOW - 1)];
+                if (next >= candidate) break; // Slot reused by a newer position
+                candidate = next;
+            }
+        }
+
+        if (bestLength >= MIN_MATCH) {
+            _writeFixedMatch(bits, bestLength, bestDistance);
+            for (int k = 0; k < bestLength; ++k) insert(i + k);
+            i += bestLength;
+        } else {
+            _writeFixedLiteral(bits, data[i]);
+            insert(i);
+            i++;
+        }
+    }
+
+    _writeFixedLiteral(bits, 256); // End of block
+    bits.flush();
+    _appendBigEndian32(out, _adler32(data, size));
+    return out;
+}
+
+
+//----------------- PNG -----------------//
+
+static const unsigned char _PNG_SIGNATURE[8] = {137, 'P', 'N', 'G', 13, 10, 26, 10};
+
+
+inline unsigned char _paeth(int a, int b, int c) {
+    int p = a + b - c;
+    int pa = abs(p - a), pb = abs(p - b), pc = abs(p - c);
+    if (pa <= pb && pa <= pc) return a;
+    if (pb <= pc) return b;
+    return c;
+}
+
+// Undo the filter of every row of one (sub)image, in place; rows are 1 + rowBytes long
+inline void _unfilterRows(unsigned char* rows, size_t rowBytes, int height, int bytesPerPixel) {
+    unsigned char* previous = nullptr;
+    for (int y = 0; y < height; ++y) {
+        unsigned char* row = rows + y * (rowBytes + 1);
+        int filter = row[0];
+        unsigned char* line = row + 1;
+        for (size_t x = 0; x < rowBytes; ++x) {
+            int left = x >= size_t(bytesPerPixel) ? line[x - bytesPerPixel] : 0;
+            int up = previous ? previous[x] : 0;
+            int upLeft = previous && x >= size_t(bytesPerPixel) ? previous[x - bytesPerPixel] : 0;
+            switch (filter) {
+                case 0: break;
+                case 1: line[x] += left; break;
+                case 2: line[x] += up; break;
+                case 3: line[x] += (left + up) / 2; break;
+                case 4: line[x] += _paeth(left, up, upLeft); break;
+                default: throw runtime_error("PNG inválido: filtro desconhecido.");
+            }
+        }
+        previous = line;
+    }
+}
+
+// Luma of an RGB triple, with the integer weights used by Pillow for "L" conversion
+inline uint8_t _luma(int r, int g, int b) {
+    return static_cast<uint8_t>((r * 19595 + g * 38470 + b * 7471 + 0x8000) >> 16);
+}
+
+
+/**
+ * Decodes a PNG file pixel by pixel
+ *
+ * Every colour type (grey, RGB, palette, with or without alpha), bit depth and
+ * filter is accepted, interlaced or not. 16-bit samples keep their high byte,
+ * alpha is ignored and grey pixels are given with r = g = b.
+ *
+ * @param filename The file name to read.
+ * @param allocate Called as allocate(width, height) once, before any pixel
+ * @param store Called as store(y, x, r, g, b) once per pixel
+ *
+ * @error If the file could not be open, is not a PNG or is damaged,
+ *        a runtime_error will be sent and the function stop
+ */
+template <typename Allocate, typename Store>
+void _decodePNG(const string& filename, Allocate allocate, Store store) {
+    MappedFile file(filename);
+    const unsigned char* cursor = file.begin();
+    const unsigned char* end = file.end();
+
+    if (file.size() < 8 || memcmp(cursor, _PNG_SIGNATURE, 8) != 0) {
+        throw runtime_error("Formato não suportado. O arquivo não é um PNG.");
+    }
+    cursor += 8;
+
+    int width = 0, height = 0, bitDepth = 0, colorType = -1, interlace = 0;
+    vector<unsigned char> palette; // r, g, b triples
+    vector<unsigned char> compressed;
+    bool finished = false;
+
+    while (!finished) {
+        if (end - cursor < 12) throw runtime_error("PNG inválido ou incompleto.");
+        uint32_t length = _readBigEndian32(cursor);
+        const unsigned char* type = cursor + 4;
+        const unsigned char* data = cursor + 8;
+        if (length > size_t(end - data) - 4) throw runtime_error("PNG inválido ou incompleto.");
+        if (_crc32(type, length + 4) != _readBigEndian32(data + length)) {
+            throw runtime_error("PNG inválido: CRC incorreto.");
+        }
+
+        if (memcmp(type, "IHDR", 4) == 0) {
+            if (length != 13) throw runtime_error("PNG inválido: cabeçalho IHDR.");
+            width = _readBigEndian32(data);
+            height = _readBigEndian32(data + 4);
+            bitDepth = data[8];
+            colorType = data[9];
+            interlace = data[12];
+            if (width <= 0 || height <= 0 || data[10] != 0 || data[11] != 0 || interlace > 1) {
+                throw runtime_error("PNG inválido: cabeçalho IHDR.");
+            }
+        } else if (memcmp(type, "PLTE", 4) == 0) {
+            palette.assign(data, data + length);
+        } else if (memcmp(type, "IDAT", 4) == 0) {
+            compressed.insert(compressed.end(), data, data + length);
+        } else if (memcmp(type, "IEND", 4) == 0) {
+            finished = true;
+        } else if (!(type[0] & 0x20)) {
+            throw runtime_error("PNG não suportado: bloco crítico desconhecido.");
+        } // Ancillary chunks (text, gamma, transparency...) are ignored
+
+        cursor = data + length + 4;
+    }
+
+    int channels;
+    switch (colorType) {
+        case 0: channels = 1; break;
+        case 2: channels = 3; break;
+        case 3: channels = 1; break;
+        case 4: channels = 2; break;
+        case 6: channels = 4; break;
+        default: throw runtime_error("PNG inválido: tipo de cor.");
+    }
+    bool validDepth = bitDepth == 8 || (bitDepth == 16 && colorType != 3)
+        || ((bitDepth == 1 || bitDepth == 2 || bitDepth == 4) && (colorType == 0 || colorType == 3));
+    if (!validDepth) throw runtime_error("PNG inválido: profundidade de bits.");
+    if (colorType == 3 && palette.empty()) throw runtime_error("PNG inválido: paleta ausente.");
+
+    int bitsPerPixel = channels * bitDepth;
+    int bytesPerPixel = max(1, bitsPerPixel / 8);
+    auto rowBytesOf = [&](int passWidth) { return (size_t(passWidth) * bitsPerPixel + 7) / 8; };
+
+    // Adam7 passes: start x, start y, step x, step y; a single full pass when not interlaced
+    static const int adam7[7][4] = {{0, 0, 8, 8}, {4, 0, 8, 8}, {0, 4, 4, 8}, {2, 0, 4, 4},
+                                    {0, 2, 2, 4}, {1, 0, 2, 2}, {0, 1, 1, 2}};
+    static const int single[1][4] = {{0, 0, 1, 1}};
+    const int (*passes)[4] = interlace ? adam7 : single;
+    int passCount = interlace ? 7 : 1;
+
+    size_t expected = 0;
+    for (int p = 0; p < passCount; ++p) {
+        int passWidth = (width - passes[p][0] + passes[p][2] - 1) / passes[p][2];
+        int passHeight = (height - passes[p][1] + passes[p][3] - 1) / passes[p][3];
+        if (passWidth > 0 && passHeight > 0) expected += (rowBytesOf(passWidth) + 1) * passHeight;
+    }
+
+    vector<unsigned char> raw = inflateZlib(compressed.data(), compressed.size(), expected);
+    if (raw.size() < expected) throw runtime_error("PNG inválido ou incompleto.");
+    compressed.clear();
+    compressed.shrink_to_fit();
+
+    // Sample c of pixel x of an unfiltered row, reduced to 8 bits (palette indexes are kept)
+    auto sample = [&](const unsigned char* line, int x, int c) -> int {
+        if (bitDepth == 8) return line[x * channels + c];
+        if (bitDepth == 16) return line[2 * (x * channels + c)];
+        int bit = x * bitDepth;
+        int value = (line[bit / 8] >> (8 - bitDepth - bit % 8)) & ((1 << bitDepth) - 1);
+        return colorType == 3 ? value : value * 255 / ((1 << bitDepth) - 1);
+    };
+    // Stores pixel px of an unfiltered line at (y, x) of the image
+    auto storePixel = [&](const unsigned char* line, int px, int y, int x) {
+        switch (colorType) {
+            case 0: case 4: {
+                int value = sample(line, px, 0);
+                store(y, x, value, value, value);
+                break;
+            }
+            case 3: {
+                size_t index = sample(line, px, 0);
+                if (3 * index + 2 >= palette.size()) throw runtime_error("PNG inválido: índice fora da paleta.");
+                store(y, x, palette[3 * index], palette[3 * index + 1], palette[3 * index + 2]);
+                break;
+            }
+            default: store(y, x, sample(line, px, 0), sample(line, px, 1), sample(line, px, 2));
+        }
+    };
+
+    allocate(width, height);
+    unsigned char* passData = raw.data();
+    for (int p = 0; p < passCount; ++p) {
+        int passWidth = (width - passes[p][0] + passes[p][2] - 1) / passes[p][2];
+        int passHeight = (height - passes[p][1] + passes[p][3] - 1) / passes[p][3];
+        if (passWidth <= 0 || passHeight <= 0) continue;
+
+        size_t rowBytes = rowBytesOf(passWidth);
+        _unfilterRows(passData, rowBytes, passHeight, bytesPerPixel);
+        for (int py = 0; py < passHeight; ++py) {
+            const unsigned char* line = passData + py * (rowBytes + 1) + 1;
+            int y = passes[p][1] + py * passes[p][3];
+            for (int px = 0; px < passWidth; ++px) {
+                storePixel(line, px, y, passes[p][0] + px * passes[p][2]);
+            }
+        }
+        passData += (rowBytes + 1) * passHeight;
+    }
+}
+
+
+/**
+ * Open a PNG image file as an 8-bit grey image
+ *
+ * Any PNG accepted by _decodePNG. Colour pixels are converted to luma with the
+ * same integer weights as Pillow's convert("L") (0.299 R + 0.587 G + 0.114 B).
+ *
+ * @param filename The file name to read.
+ * @return The grey image.
+ *
+ * @error If the file could not be open, is not a PNG or is damaged,
+ *        a runtime_error will be sent and the function stop
+ */
+Image<uint8_t> loadPNG(const string& filename) {
+    Image<uint8_t> image;
+    _decodePNG(filename,
+        [&](int width, int height) { image = Image<uint8_t>(width, height); },
+        [&](int y, int x, int r, int g, int b) { image.at(y, x) = _luma(r, g, b); });
+    return image;
+}
+
+
+/**
+ * Open a PNG image file as three 8-bit colour planes
+ *
+ * Same formats as loadPNG; grey images give three equal planes.
+ *
+ * @param filename The file name to read.
+ * @return The red, green and blue planes.
+ *
+ * @error If the file could not be open, is not a PNG or is damaged,
+ *        a runtime_error will be sent and the function stop
+ */
+PlanarImage<uint8_t> loadPNGPlanar(const string& filename) {
+    PlanarImage<uint8_t> image;
+    _decodePNG(filename,
+        [&](int width, int height) { image = PlanarImage<uint8_t>(width, height); },
+        [&](int y, int x, int r, int g, int b) {
+            image.plane(0).at(y, x) = r;
+            image.plane(1).at(y, x) = g;
+            image.plane(2).at(y, x) = b;
+        });
+    return image;
+}
+
+
+/**
+ * Filter the rows of an 8-bit image and write it as a PNG file
+ *
+ * Each row uses the filter with the smallest sum of absolute values (the usual
+ * heuristic), then everything is compressed by deflateZlib into one IDAT chunk.
+ */
+inline void _savePNG(const string& filename, const unsigned char* const* rows, int width, int height,
+                     int channels, PnmWriteMode mode) {
+    size_t rowBytes = size_t(width) * channels;
+    vector<unsigned char> filtered((rowBytes + 1) * height);
+    vector<unsigned char> candidate(rowBytes);
+
+    for (int y = 0; y < height; ++y) {
+        const unsigned char* line = rows[y];
+        const unsigned char* previous = y > 0 ? rows[y - 1] : nullptr;
+        unsigned char* target = filtered.data() + y * (rowBytes + 1);
+
+        long bestScore = -1;
+        for (int filter = 0; filter <= 4; ++filter) {
+            long score = 0;
+            for (size_t x = 0; x < rowBytes; ++x) {
+                int left = x >= size_t(channels) ? line[x - channels] : 0;
+                int up = previous ? previous[x] : 0;
+                int upLeft = previous && x >= size_t(channels) ? previous[x - channels] : 0;
+                int predicted = filter == 0 ? 0 : filter == 1 ? left : filter == 2 ? up
+                              : filter == 3 ? (left + up) / 2 : _paeth(left, up, upLeft);
+                candidate[x] = static_cast<unsigned char>(line[x] - predicted);
+                score += abs(static_cast<signed char>(candidate[x]));
+            }
+            if (bestScore < 0 || score < bestScore) {
+                bestScore = score;
+                target[0] = filter;
+                memcpy(target + 1, candidate.data(), rowBytes);
+            }
+        }
+    }
+
+    vector<unsigned char> compressed = deflateZlib(filtered.data(), filtered.size());
+    filtered.clear();
+    filtered.shrink_to_fit();
+
+    vector<unsigned char> header;
+    _appendBigEndian32(header, width);
+    _appendBigEndian32(header, height);
+    header.push_back(8);                        // Bit depth
+    header.push_back(channels == 3 ? 2 : 0);    // Colour type: RGB or grey
+    header.push_back(0);                        // Deflate
+    header.push_back(0);                        // Adaptive filtering
+    header.push_back(0);                        // Not interlaced
+
+    auto chunkSize = [](size_t length) { return 12 + length; };
+    _PnmOutput output(filename, 8 + chunkSize(header.size()) + chunkSize(compressed.size()) + chunkSize(0), mode);
+    output.write(_PNG_SIGNATURE, 8);
+
+    auto writeChunk = [&](const char* type, const vector<unsigned char>& data) {
+        unsigned char prefix[8];
+        uint32_t length = static_cast<uint32_t>(data.size());
+        prefix[0] = length >> 24; prefix[1] = length >> 16; prefix[2] = length >> 8; prefix[3] = length;
+        memcpy(prefix + 4, type, 4);
+        uint32_t crc = _crc32(prefix + 4, 4);
+        crc = _crc32(data.data(), data.size(), crc);
+        unsigned char suffix[4] = {static_cast<unsigned char>(crc >> 24), static_cast<unsigned char>(crc >> 16),
+                                   static_cast<unsigned char>(crc >> 8), static_cast<unsigned char>(crc)};
+        output.write(prefix, 8);
+        output.write(data.data(), data.size());
+        output.write(suffix, 4);
+    };
+    writeChunk("IHDR", header);
+    writeChunk("IDAT", compressed);
+    writeChunk("IEND", {});
+    output.finish();
+}
+
+
+/**
+ * Write an 8-bit grey image as a PNG file
+ *
+ * @param filename The file name to write.
+ * @param image The image.
+ * @param mode Buffered or memory-mapped output.
+ *
+ * @error If the file could not be written, a runtime_error is thrown
+ */
+void savePNG(const string& filename, ImageView<const uint8_t> image, PnmWriteMode mode = PnmWriteMode::Buffered) {
+    vector<const unsigned char*> rows(image.getHeight());
+    for (int y = 0; y < image.getHeight(); ++y) rows[y] = image.row(y);
+    _savePNG(filename, rows.data(), image.getWidth(), image.getHeight(), 1, mode);
+}
+
+
+/**
+ * Write a colour image as an 8-bit RGB PNG file
+ *
+ * @tparam RGB Pixel type with uint8_t members r, g and b, in this order (e.g. colorpgm::RGBPixel)
+ * @param filename The file name to write.
+ * @param image The image.
+ * @param mode Buffered or memory-mapped output.
+ *
+ * @error If the file could not be written, a runtime_error is thrown
+ */
+template <typename RGB>
+void savePNG(const string& filename, ImageView<const RGB> image, PnmWriteMode mode = PnmWriteMode::Buffered) {
+    static_assert(sizeof(RGB) == 3, "RGB pixels must be packed as r, g, b");
+    vector<const unsigned char*> rows(image.getHeight());
+    for (int y = 0; y < image.getHeight(); ++y) rows[y] = reinterpret_cast<const unsigned char*>(image.row(y));
+    _savePNG(filename, rows.data(), image.getWidth(), image.getHeight(), 3, mode);
+}
+
+#endif // PNG_HPP